@@ -0,0 +1,143 @@
+#include "animation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+namespace {
+
+// Characters in `text`, skipping colour escapes and UTF-8 continuation bytes
+int visibleLength(const string& text) {
+    int length = 0;
+    bool inEscape = false;
+    for (unsigned char c : text) {
+        if (c == '\033') {
+            inEscape = true;
+        } else if (inEscape) {
+            inEscape = c != 'm';
+        } else if ((c & 0xC0) != 0x80) {
+            length++;
+        }
+    }
+    return length;
+}
+
+} // namespace
+
+ProjectileAnimation::ProjectileAnimation(int fromX, int fromY, int toX, int toY, int cellWidth, int line,
+                                         int ticksPerCell)
+    : fromX(fromX), fromY(fromY), toX(toX), toY(toY), steps(max(abs(toX - fromX), abs(toY - fromY))),
+      cellWidth(cellWidth), line(line), ticksPerCell(max(ticksPerCell, 1)) {}
+
+bool ProjectileAnimation::isFinished(long long ticks) const {
+    return ticks / ticksPerCell > steps;
+}
+
+void ProjectileAnimation::draw(TerminalRenderer& screen, int originX, int originY, long long ticks) const {
+    long long step = ticks / ticksPerCell;
+    if (step > steps) {
+        return;
+    }
+    int x = fromX;
+    int y = fromY;
+    if (steps > 0) {
+        x = static_cast<int>(lround(fromX + (toX - fromX) * static_cast<double>(step) / steps));
+        y = static_cast<int>(lround(fromY + (toY - fromY) * static_cast<double>(step) / steps));
+    }
+    if (!screen.inGrid(x - originX, y - originY)) {
+        return; // Outside the viewport
+    }
+    string& cell = screen.overlayCellLine(x - originX, y - originY, line);
+    cell.assign(cellWidth, ' ');
+    cell[cellWidth / 2] = 'o';
+}
+
+TypedLineAnimation::TypedLineAnimation(const string& text, int ticksPerChar, int holdTicks)
+    : text(text), length(visibleLength(text)), ticksPerChar(max(ticksPerChar, 1)), holdTicks(holdTicks) {}
+
+bool TypedLineAnimation::isFinished(long long ticks) const {
+    return ticks >= static_cast<long long>(length) * ticksPerChar + holdTicks;
+}
+
+void TypedLineAnimation::draw(TerminalRenderer& screen, int, int, long long ticks) const {
+    long long shown = min<long long>(ticks / ticksPerChar + 1, length);
+    string& line = screen.addOverlayLine();
+    if (shown >= length) {
+        line = text;
+        return;
+    }
+    // Escapes and the rest of a character go with the character before them
+    long long count = 0;
+    bool inEscape = false;
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (byte == '\033') {
+            inEscape = true;
+        } else if (inEscape) {
+            inEscape = byte != 'm';
+        } else if ((byte & 0xC0) != 0x80 && count++ == shown) {
+            break;
+        }
+        line += c;
+    }
+    line += "\033[0m";
+}
+
+AnimationScheduler::AnimationScheduler() : epoch(chrono::steady_clock::now()), tick(0), enabled(true) {}
+
+long long AnimationScheduler::tickAt(chrono::steady_clock::time_point time) const {
+    long long us = chrono::duration_cast<chrono::microseconds>(time - epoch).count();
+    return us * TICKS_PER_SECOND / 1000000;
+}
+
+void AnimationScheduler::setEnabled(bool on) {
+    enabled = on;
+    if (!enabled) {
+        running.clear();
+    }
+}
+
+void AnimationScheduler::add(unique_ptr<Animation> animation, int group) {
+    if (!enabled) {
+        return;
+    }
+    tick = max(tick, tickAt(chrono::steady_clock::now()));
+    running.push_back({move(animation), tick, group});
+}
+
+void AnimationScheduler::stopGroup(int group) {
+    running.erase(remove_if(running.begin(), running.end(),
+                            [group](const Running& entry) { return entry.group == group; }),
+                  running.end());
+}
+
+int AnimationScheduler::msUntilTick() const {
+    if (running.empty()) {
+        return -1;
+    }
+    auto next = epoch + chrono::microseconds((tick + 1) * 1000000 / TICKS_PER_SECOND);
+    auto left = chrono::duration_cast<chrono::microseconds>(next - chrono::steady_clock::now()).count();
+    return left <= 0 ? 0 : static_cast<int>((left + 999) / 1000);
+}
+
+bool AnimationScheduler::update() {
+    long long now = tickAt(chrono::steady_clock::now());
+    if (now <= tick) {
+        return false;
+    }
+    tick = now;
+    running.erase(remove_if(running.begin(), running.end(),
+                            [this](const Running& entry) {
+                                return entry.animation->isFinished(tick - entry.startTick);
+                            }),
+                  running.end());
+    return true;
+}
+
+void AnimationScheduler::drawOver(TerminalRenderer& screen, int originX, int originY) const {
+    for (const Running& entry : running) {
+        entry.animation->draw(screen, originX, originY, tick - entry.startTick);
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "render.h"
+
+// Screen effects that never sleep. An animation is a timeline: what it shows
+// is a function of the ticks since it started, so it is drawn right even
+// after a stall such as a search or a prompt, and never has to be stepped
+// one tick at a time. The scheduler keeps a fixed 60 Hz clock. While the game
+// waits for a key it asks how long it may wait before the next tick is due,
+// and on each tick it presents the frame it already built again, with the
+// effects laid over it. While disabled the scheduler holds nothing, and the
+// game does not build animations at all.
+
+class Animation {
+public:
+    virtual ~Animation() {}
+    // True once nothing is left to show, `ticks` after the start
+    virtual bool isFinished(long long ticks) const = 0;
+    // Lays the effect over the frame; (originX, originY) is the board cell in
+    // the grid's top-left corner
+    virtual void draw(TerminalRenderer& screen, int originX, int originY, long long ticks) const = 0;
+};
+
+// A shot flying in a straight line between two board cells, one cell every
+// `ticksPerCell`, drawn as an 'o' across line `line` of the cell it is over
+class ProjectileAnimation : public Animation {
+private:
+    int fromX;
+    int fromY;
+    int toX;
+    int toY;
+    int steps; // Cells after the first
+    int cellWidth;
+    int line;
+    int ticksPerCell;
+public:
+    ProjectileAnimation(int fromX, int fromY, int toX, int toY, int cellWidth, int line, int ticksPerCell);
+    bool isFinished(long long ticks) const override;
+    void draw(TerminalRenderer& screen, int originX, int originY, long long ticks) const override;
+};
+
+// A text line below the frame, typed out one character every `ticksPerChar`
+// and then left up for `holdTicks`. Colour escapes count as no characters.
+class TypedLineAnimation : public Animation {
+private:
+    std::string text;
+    int length; // In characters
+    int ticksPerChar;
+    int holdTicks;
+public:
+    TypedLineAnimation(const std::string& text, int ticksPerChar, int holdTicks);
+    bool isFinished(long long ticks) const override;
+    void draw(TerminalRenderer& screen, int originX, int originY, long long ticks) const override;
+};
+
+class AnimationScheduler {
+public:
+    static const int TICKS_PER_SECOND = 60;
+private:
+    struct Running {
+        std::unique_ptr<Animation> animation;
+        long long startTick;
+        int group;
+    };
+    std::vector<Running> running; // In the order they were added
+    std::chrono::steady_clock::time_point epoch;
+    long long tick; // The tick update() last reached
+    bool enabled;
+    long long tickAt(std::chrono::steady_clock::time_point time) const;
+public:
+    AnimationScheduler();
+    void setEnabled(bool on);
+    bool isEnabled() const { return enabled; }
+    // Starts `animation` on the current tick; dropped while disabled. The
+    // group is the caller's, for stopGroup().
+    void add(std::unique_ptr<Animation> animation, int group = 0);
+    // Drops the running animations added with `group`
+    void stopGroup(int group);
+    bool isIdle() const { return running.empty(); }
+    // Milliseconds until the next tick is due, or -1 with nothing running:
+    // how long the game may wait for a key
+    int msUntilTick() const;
+    // Moves to the current tick and drops the animations that finished.
+    // True if that is a new tick, so the frame needs presenting again.
+    bool update();
+    // Lays every running animation over the frame, as of the last update()
+    void drawOver(TerminalRenderer& screen, int originX, int originY) const;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <string>
+
+// Sound for the interactive game. The game only talks to AudioBackend, and no
+// call on it waits for the device or a decoder, so sound never holds up a
+// turn. NullAudio is what headless and --no-sound runs get; SdlAudio
+// (sdl_audio.h) plays through SDL_mixer.
+
+enum SoundEffect { SOUND_JUMP = 0, SOUND_GAME_OVER, SOUND_COUNT };
+
+class AudioBackend {
+public:
+    virtual ~AudioBackend() {}
+    // Waits until the device and assets are loaded. False, with the reasons
+    // in `errors`, if some of them are unusable; playing still works then,
+    // but is silent.
+    virtual bool waitUntilReady(std::string& errors) = 0;
+    // Milliseconds loading took, or -1 when there was nothing to load
+    virtual double getLoadMs() const = 0;
+    virtual void playMusic() = 0;
+    virtual void stopMusic() = 0;
+    // Returns at once: the effect starts shortly after, unless the same one
+    // started so recently that it is merged into that one
+    virtual void playEffect(SoundEffect effect) = 0;
+    virtual long long getCoalescedEffects() const = 0;
+};
+
+// No device, no thread, no allocations
+class NullAudio : public AudioBackend {
+public:
+    bool waitUntilReady(std::string&) override { return true; }
+    double getLoadMs() const override { return -1; }
+    void playMusic() override {}
+    void stopMusic() override {}
+    void playEffect(SoundEffect) override {}
+    long long getCoalescedEffects() const override { return 0; }
+};
+
+#endif
@@ -2,14 +2,10 @@
 
 # Script to compile and run the game
 
-# Compilation command
-g++ -std=c++11 juego.cpp -o juego -lncurses \
-    -I/opt/homebrew/opt/sdl2/include/SDL2 \
-    -I/opt/homebrew/opt/sdl2_mixer/include/SDL2 \
-    -L/opt/homebrew/opt/sdl2/lib \
-    -L/opt/homebrew/opt/sdl2_mixer/lib \
-    -L/opt/homebrew/lib \
-    -lSDL2 -lSDL2_mixer
+# Compilation command (engine library + game)
+cmake -S . -B build -DCMAKE_BUILD_TYPE=Release -DCMAKE_PREFIX_PATH=/opt/homebrew \
+    && cmake --build build \
+    && cp build/juego .
 
 # Check if compilation was successful
 if [ $? -eq 0 ]; then
@@ -0,0 +1,844 @@
+#include "engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+// Zobrist keys are derived on demand rather than stored: a SplitMix64
+// finalizer over (feature, player, value) spreads as well as a random table
+// and costs no memory however large the board is
+enum ZobristFeature : uint64_t { ZOBRIST_CELL = 1, ZOBRIST_EXTREMITY_HITS, ZOBRIST_ELIMINATED };
+
+uint64_t zobristKey(uint64_t feature, uint64_t id, uint64_t value) {
+    return splitMix64((feature << 56) ^ (id << 32) ^ value);
+}
+
+uint64_t cellKey(const Board& board, int id, int x, int y) {
+    return zobristKey(ZOBRIST_CELL, id, static_cast<uint64_t>(y) * board.getCols() + x);
+}
+
+// Manhattan distance from `flag` to the nearest active player of `team`
+int closestToFlag(const Match& state, char team, pair<int, int> flag) {
+    const PlayerTable& players = state.getPlayers();
+    int best = state.getRows() + state.getCols();
+    for (int id = state.teamBegin(team); id < state.teamEnd(team); ++id) {
+        if (!players.isEliminated(id)) {
+            best = min(best, abs(players.getX(id) - flag.first) + abs(players.getY(id) - flag.second));
+        }
+    }
+    return best;
+}
+
+} // namespace
+
+// Cell implementation
+bool Cell::addPlayer(int index) {
+    if (count >= CAPACITY) {
+        return false;
+    }
+    players[count++] = index;
+    return true;
+}
+
+void Cell::insertPlayer(int index, int slot) {
+    for (int i = count; i > slot; --i) {
+        players[i] = players[i - 1];
+    }
+    players[slot] = index;
+    ++count;
+}
+
+void Cell::removePlayer(int index) {
+    for (int i = 0; i < count; ++i) {
+        if (players[i] == index) {
+            // Shift the later arrivals down to keep insertion order
+            for (int j = i + 1; j < count; ++j) {
+                players[j - 1] = players[j];
+            }
+            --count;
+            return;
+        }
+    }
+}
+
+void Board::resize(int numRows, int numCols) {
+    rows = numRows;
+    cols = numCols;
+    cells.assign(static_cast<size_t>(rows) * cols, Cell());
+}
+
+const char* eliminationReasonText(EliminationReason reason) {
+    switch (reason) {
+        case HIT_IN_TORSO: return "Hit in torso";
+        case THREE_EXTREMITY_HITS: return "3 extremity hits";
+        case HEADSHOT_PENALTY: return "Headshot penalty";
+        case NOT_ELIMINATED: break;
+    }
+    return "";
+}
+
+void PlayerTable::reserve(size_t count) {
+    xs.reserve(count);
+    ys.reserve(count);
+    startXs.reserve(count);
+    startYs.reserve(count);
+    teams.reserve(count);
+    archetypes.reserve(count);
+    extremityHits.reserve(count);
+    eliminationReasons.reserve(count);
+    movedRounds.reserve(count);
+}
+
+int PlayerTable::add(char team, bool fast, bool expert, int x, int y) {
+    int id = size();
+    xs.push_back(x);
+    ys.push_back(y);
+    startXs.push_back(x);
+    startYs.push_back(y);
+    teams.push_back(team);
+    archetypes.push_back((fast ? ARCH_FAST : 0) | (expert ? ARCH_EXPERT : 0));
+    extremityHits.push_back(0);
+    eliminationReasons.push_back(NOT_ELIMINATED);
+    movedRounds.push_back(0);
+    return id;
+}
+
+void PlayerTable::restore(int id, int x, int y, int hits, EliminationReason reason, uint32_t movedRound) {
+    xs[id] = x;
+    ys[id] = y;
+    extremityHits[id] = static_cast<uint8_t>(hits);
+    eliminationReasons[id] = reason;
+    movedRounds[id] = movedRound;
+}
+
+uint64_t freshSeed() {
+    random_device device;
+    uint64_t entropy = (static_cast<uint64_t>(device()) << 32) ^ device();
+    return splitMix64(entropy ^ static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count()));
+}
+
+Match::Match(uint64_t seed, const Rules& rules)
+    : numPlayersPerTeam(0), rules(rules), redCount(0), redFlag(0, 0), blueFlag(0, 0),
+      teamStats{{0, 0, {0, 0}, {}}, {0, 0, {0, 0}, {}}}, seed(seed), rng(seed), hash(0) {
+    for (int archetype = 0; archetype < 4; ++archetype) {
+        hitTable[archetype] = hitThresholdsFor(rules.hitChancesFor((archetype & ARCH_EXPERT) != 0));
+    }
+}
+
+void Match::setup(int rows, int cols, int playersPerTeam) {
+    int numRows = rows;
+    int numCols = cols;
+    numPlayersPerTeam = playersPerTeam;
+
+    // Initialize board with specified rows and columns
+    board.resize(numRows, numCols);
+
+    // Randomly assign flag positions
+    if (random(-1, RNG_FLAG_SIDE) < 0.5) {
+        redFlag = make_pair(0, 0);
+        blueFlag = make_pair(numCols - 1, numRows - 1);
+    } else {
+        redFlag = make_pair(numCols - 1, numRows - 1);
+        blueFlag = make_pair(0, 0);
+    }
+
+    // Initialize players for each team
+    players.reserve(2 * static_cast<size_t>(numPlayersPerTeam));
+
+    // Function to place players starting from a base cell
+    auto placePlayers = [&](char team, int startX, int startY) {
+        int x = startX;
+        int y = startY;
+        int playersAdded = 0;
+
+        while (playersAdded < numPlayersPerTeam) {
+            Cell& cell = board.at(x, y);
+
+            // Only add one player per cell during initialization
+            if (playersAdded < numPlayersPerTeam) {
+                // Determine player type based on probabilities
+                double randomValue = random(players.size(), RNG_ARCHETYPE);
+                bool fast = false, expert = false;
+
+                if (randomValue < rules.fastExpertBelow) {
+                    fast = true; expert = true; // Fast Expert (ER)
+                } else if (randomValue < rules.slowExpertBelow) {
+                    fast = false; expert = true; // Slow Expert (EL)
+                } else if (randomValue < rules.fastNoviceBelow) {
+                    fast = true; expert = false; // Fast Novice (NR)
+                } else {
+                    fast = false; expert = false; // Slow Rookie (NL)
+                }
+
+                int id = players.add(team, fast, expert, x, y);
+                cell.addPlayer(id);
+                playersAdded++;
+            }
+
+            // Move to the next cell in the row or column
+            if (startX == 0) x++;
+            else x--;
+
+            if (x < 0 || x >= numCols) {
+                x = startX;
+                if (startY == 0) y++;
+                else y--;
+                if (y < 0 || y >= numRows) break;
+            }
+        }
+    };
+
+    // Place Red Team players starting from redFlag position
+    placePlayers('R', redFlag.first, redFlag.second);
+    redCount = players.size();
+
+    // Place Blue Team players starting from blueFlag position
+    placePlayers('B', blueFlag.first, blueFlag.second);
+
+    // Seed the incremental team counters from the initial placement
+    for (int id = 0; id < players.size(); ++id) {
+        TeamStats& stats = teamStats[teamIndex(players.getTeam(id))];
+        stats.active++;
+        stats.unmoved++;
+        updateFlagCounts(id, players.getX(id), players.getY(id), +1);
+    }
+    hash = computeHash();
+}
+
+uint64_t Match::computeHash() const {
+    uint64_t result = 0;
+    for (int id = 0; id < players.size(); ++id) {
+        result ^= cellKey(board, id, players.getX(id), players.getY(id));
+        result ^= zobristKey(ZOBRIST_EXTREMITY_HITS, id, players.getHitsToExtremities(id));
+        if (players.isEliminated(id)) {
+            result ^= zobristKey(ZOBRIST_ELIMINATED, id, 0);
+        }
+    }
+    return result;
+}
+
+void Match::saveSnapshot(MatchSnapshot& out) const {
+    int count = players.size();
+    out.round = players.getRound();
+    out.xs.resize(count);
+    out.ys.resize(count);
+    out.slots.resize(count);
+    out.extremityHits.resize(count);
+    out.eliminationReasons.resize(count);
+    out.movedRounds.resize(count);
+    for (int id = 0; id < count; ++id) {
+        int x = players.getX(id);
+        int y = players.getY(id);
+        const Cell& cell = board.at(x, y);
+        int slot = 0;
+        while (slot < cell.size() && cell[slot] != id) {
+            ++slot;
+        }
+        out.xs[id] = x;
+        out.ys[id] = y;
+        out.slots[id] = static_cast<uint8_t>(slot);
+        out.extremityHits[id] = static_cast<uint8_t>(players.getHitsToExtremities(id));
+        out.eliminationReasons[id] = players.getEliminationReason(id);
+        out.movedRounds[id] = players.getMovedRound(id);
+    }
+    for (int team = 0; team < 2; ++team) {
+        out.eliminated[team] = teamStats[team].eliminated;
+    }
+}
+
+void Match::restoreSnapshot(const MatchSnapshot& snapshot) {
+    int count = players.size();
+    board.resize(board.getRows(), board.getCols());
+    players.setRound(snapshot.round);
+    for (int id = 0; id < count; ++id) {
+        players.restore(id, snapshot.xs[id], snapshot.ys[id], snapshot.extremityHits[id],
+                        static_cast<EliminationReason>(snapshot.eliminationReasons[id]), snapshot.movedRounds[id]);
+    }
+
+    // Cells are refilled slot by slot so every cell keeps its arrival order
+    for (int slot = 0; slot < Cell::CAPACITY; ++slot) {
+        for (int id = 0; id < count; ++id) {
+            if (snapshot.slots[id] == slot) {
+                board.at(snapshot.xs[id], snapshot.ys[id]).addPlayer(id);
+            }
+        }
+    }
+
+    for (int team = 0; team < 2; ++team) {
+        teamStats[team] = {0, 0, {0, 0}, snapshot.eliminated[team]};
+    }
+    for (int id = 0; id < count; ++id) {
+        if (!players.isEliminated(id)) {
+            TeamStats& stats = teamStats[teamIndex(players.getTeam(id))];
+            stats.active++;
+            if (!players.hasMoved(id)) {
+                stats.unmoved++;
+            }
+            updateFlagCounts(id, players.getX(id), players.getY(id), +1);
+        }
+    }
+    hash = computeHash();
+}
+
+void Match::pushUndo(int actor, vector<UndoEntry>& undo) const {
+    UndoEntry entry;
+    entry.hash = hash;
+    entry.round = players.getRound();
+    entry.actor = actor;
+    entry.target = -1;
+    entry.location = HIT_MISS;
+    entry.slot = 0;
+    entry.extremityHits = 0;
+    entry.eliminationReason = NOT_ELIMINATED;
+    entry.x = entry.y = 0;
+    entry.movedRound = 0;
+    if (actor >= 0) {
+        entry.x = players.getX(actor);
+        entry.y = players.getY(actor);
+        const Cell& cell = board.at(entry.x, entry.y);
+        while (entry.slot < cell.size() && cell[entry.slot] != actor) {
+            ++entry.slot;
+        }
+        entry.extremityHits = static_cast<uint8_t>(players.getHitsToExtremities(actor));
+        entry.eliminationReason = players.getEliminationReason(actor);
+        entry.movedRound = players.getMovedRound(actor);
+    }
+    for (int team = 0; team < 2; ++team) {
+        entry.active[team] = teamStats[team].active;
+        entry.unmoved[team] = teamStats[team].unmoved;
+        entry.onFlag[team][0] = teamStats[team].onFlag[0];
+        entry.onFlag[team][1] = teamStats[team].onFlag[1];
+        entry.eliminatedCount[team] = static_cast<uint32_t>(teamStats[team].eliminated.size());
+    }
+    undo.push_back(entry);
+}
+
+MoveResult Match::makeMove(int id, int direction, int squares, vector<UndoEntry>& undo) {
+    pushUndo(id, undo);
+    return move(id, direction, squares);
+}
+
+AttackResult Match::makeAttack(int id, int direction, int squares, vector<UndoEntry>& undo) {
+    pushUndo(id, undo);
+    AttackResult result = attack(id, direction, squares);
+    if (result.fired()) {
+        undo.back().target = result.target;
+        undo.back().location = result.location;
+    }
+    return result;
+}
+
+AttackResult Match::makeResolvedAttack(int id, int direction, int squares, HitLocation location,
+                                       vector<UndoEntry>& undo) {
+    pushUndo(id, undo);
+    AttackResult result = resolveAttack(id, direction, squares, location);
+    if (result.fired()) {
+        undo.back().target = result.target;
+        undo.back().location = result.location;
+    }
+    return result;
+}
+
+void Match::makeNewRound(vector<UndoEntry>& undo) {
+    pushUndo(-1, undo);
+    resetPlayersMovedFlag();
+}
+
+void Match::unmake(vector<UndoEntry>& undo) {
+    const UndoEntry& entry = undo.back();
+    if (entry.target >= 0) {
+        // The target was active when shot; only an extremity hit adds to its count
+        int hits = players.getHitsToExtremities(entry.target) - (entry.location == HIT_EXTREMITY ? 1 : 0);
+        players.restore(entry.target, players.getX(entry.target), players.getY(entry.target), hits,
+                        NOT_ELIMINATED, players.getMovedRound(entry.target));
+    }
+    if (entry.actor >= 0) {
+        int x = players.getX(entry.actor);
+        int y = players.getY(entry.actor);
+        if (x != entry.x || y != entry.y) {
+            board.at(x, y).removePlayer(entry.actor);
+            board.at(entry.x, entry.y).insertPlayer(entry.actor, entry.slot);
+        }
+        players.restore(entry.actor, entry.x, entry.y, entry.extremityHits,
+                        static_cast<EliminationReason>(entry.eliminationReason), entry.movedRound);
+    }
+    for (int team = 0; team < 2; ++team) {
+        TeamStats& stats = teamStats[team];
+        stats.active = entry.active[team];
+        stats.unmoved = entry.unmoved[team];
+        stats.onFlag[0] = entry.onFlag[team][0];
+        stats.onFlag[1] = entry.onFlag[team][1];
+        stats.eliminated.resize(entry.eliminatedCount[team]);
+    }
+    players.setRound(entry.round);
+    hash = entry.hash;
+    undo.pop_back();
+}
+
+void Match::resetPlayersMovedFlag() {
+    players.resetMoved();
+    for (TeamStats& stats : teamStats) {
+        stats.unmoved = stats.active;
+    }
+}
+
+void Match::markMoved(int id) {
+    if (players.hasMoved(id)) {
+        return;
+    }
+    players.setMoved(id);
+    if (!players.isEliminated(id)) {
+        teamStats[teamIndex(players.getTeam(id))].unmoved--;
+    }
+}
+
+void Match::eliminate(int id, EliminationReason reason) {
+    if (players.isEliminated(id)) {
+        return;
+    }
+    TeamStats& stats = teamStats[teamIndex(players.getTeam(id))];
+    updateFlagCounts(id, players.getX(id), players.getY(id), -1);
+    if (!players.hasMoved(id)) {
+        stats.unmoved--;
+    }
+    stats.active--;
+    stats.eliminated.push_back(id);
+    players.setEliminated(id, reason);
+    hash ^= zobristKey(ZOBRIST_ELIMINATED, id, 0);
+}
+
+// Only active players count towards flag occupancy
+void Match::updateFlagCounts(int id, int x, int y, int delta) {
+    if (players.isEliminated(id)) {
+        return;
+    }
+    TeamStats& stats = teamStats[teamIndex(players.getTeam(id))];
+    if (x == redFlag.first && y == redFlag.second) {
+        stats.onFlag[0] += delta;
+    }
+    if (x == blueFlag.first && y == blueFlag.second) {
+        stats.onFlag[1] += delta;
+    }
+}
+
+MatchOutcome Match::checkEndConditions() const {
+    const TeamStats& red = teamStats[0];
+    const TeamStats& blue = teamStats[1];
+
+    // Check if all players have moved at least once in the current turn
+    bool redAllMoved = red.unmoved == 0;
+    bool blueAllMoved = blue.unmoved == 0;
+
+    // Apply retreat logic only if all players have moved
+    if (redAllMoved && blueAllMoved) {
+        // Proceed with retreat checks as per your existing logic
+        // ...
+    }
+
+    // Check if any team reached opponent's flag area
+    if (red.onFlag[1] > 0) {
+        return {FLAG_CAPTURED, 'R'};
+    }
+    if (blue.onFlag[0] > 0) {
+        return {FLAG_CAPTURED, 'B'};
+    }
+
+    // Check if all players of one team are eliminated
+    if (red.active == 0) {
+        return {TEAM_ELIMINATED, 'B'};
+    }
+    if (blue.active == 0) {
+        return {TEAM_ELIMINATED, 'R'};
+    }
+
+    // Check if only players in flag area remain
+    if (red.onFlag[0] == red.active) {
+        return {RETREAT, 'B'};
+    }
+    if (blue.onFlag[1] == blue.active) {
+        return {RETREAT, 'R'};
+    }
+
+    return {NOT_ENDED, 0};
+}
+
+MoveResult Match::move(int id, int direction, int squares) {
+    markMoved(id);
+    const char team = players.getTeam(id);
+    const int maxMovement = players.getMaxMovement(id);
+    int x = players.getX(id);
+    int y = players.getY(id);
+
+    if (squares != -1 && squares != 1 && squares != 2) { // Anything else would step off the board
+        return {MOVE_INVALID_DISTANCE, id, squares, maxMovement, x, y, x, y};
+    }
+    if (squares == -1) { // Random movement for automatic mode
+        if (players.isFast(id)) {
+            squares = (random(id, RNG_MOVE_DISTANCE) <= 0.5) ? 2 : 1; // 50% chance for moving 2 squares
+        } else {
+            squares = 1; // Slow players can only move 1 square
+        }
+    }
+
+    MoveResult result = {MOVE_OK, id, squares, maxMovement, x, y, x, y};
+
+    // Validate movement capacity
+    if (squares > maxMovement) {
+        result.status = MOVE_TOO_FAR;
+        return result;
+    }
+
+    int dx = 0, dy = 0;
+    switch (direction) {
+        case UP: dy = -1; break;
+        case DOWN: dy = 1; break;
+        case LEFT: dx = -1; break;
+        case RIGHT: dx = 1; break;
+        default: 
+            result.status = MOVE_INVALID_DIRECTION;
+            return result;
+    }
+
+    for (int i = 1; i <= squares; ++i) {
+        int nx = x + dx * i;
+        int ny = y + dy * i;
+        if (!board.inBounds(nx, ny)) {
+            result.status = MOVE_OUT_OF_BOUNDS;
+            return result;
+        }
+        const Cell& cell = board.at(nx, ny);
+
+        // Check for opponent players in any cell along the path
+        for (int k = 0; k < cell.size(); ++k) {
+            if (players.getTeam(cell[k]) != team) {
+                result.status = MOVE_BLOCKED_BY_OPPONENT;
+                return result;
+            }
+        }
+
+        // Check max 4 players per cell only for the destination cell
+        if (i == squares && cell.isFull()) {
+            result.status = MOVE_DESTINATION_FULL;
+            return result;
+        }
+    }
+
+    // Move the player
+    board.at(x, y).removePlayer(id);
+    updateFlagCounts(id, x, y, -1);
+    hash ^= cellKey(board, id, x, y);
+    x += dx * squares;
+    y += dy * squares;
+
+    // Attempt to add player to the new cell
+    board.at(x, y).addPlayer(id);
+    players.setPosition(id, x, y);
+    updateFlagCounts(id, x, y, +1);
+    hash ^= cellKey(board, id, x, y);
+
+    result.toX = x;
+    result.toY = y;
+    return result;
+}
+
+// Validates an attack and finds its target. Returns ATTACK_FIRED with the
+// target set when a shot can be taken; nothing has been rolled for it yet.
+AttackResult Match::aimAttack(int id, int direction, int squares) {
+    markMoved(id);
+    const char team = players.getTeam(id);
+    const bool expert = players.isExpert(id);
+    const int x = players.getX(id);
+    const int y = players.getY(id);
+    AttackResult result = {ATTACK_FIRED, HIT_MISS, expert, 0, id, -1};
+
+    // 1. Validate direction (orthogonal attacks only)
+    int dx = 0, dy = 0;
+    switch (direction) {
+        case UP: dy = -1; break;
+        case DOWN: dy = 1; break;
+        case LEFT: dx = -1; break;
+        case RIGHT: dx = 1; break;
+        default: 
+            result.status = ATTACK_INVALID_DIRECTION;
+            return result;
+    }
+
+    // 2. Determine and validate attack range
+    int attackRange;
+    if (squares == -1) { // Random range for automatic mode
+        if (expert) {
+            attackRange = (random(id, RNG_ATTACK_RANGE) <= 0.75) ? 1 : 2; // 75% chance for 1 square, 25% for 2
+        } else {
+            attackRange = 1; // Novice can only attack 1 square
+        }
+        squares = attackRange;
+    } else {
+        // Validate manual range input
+        if (squares > players.getAttackRange(id) || squares < 1) {
+            result.status = ATTACK_INVALID_RANGE;
+            return result;
+        }
+    }
+
+    // Calculate target position
+    int targetX = x + (dx * squares);
+    int targetY = y + (dy * squares);
+    
+    // Check if target is in bounds
+    if (!board.inBounds(targetX, targetY)) {
+        result.status = ATTACK_OUT_OF_BOUNDS;
+        return result;
+    }
+
+    // 3. Check line of sight (no obstacles between attacker and target)
+    for (int i = 1; i < squares; i++) {
+        if (!board.at(x + (dx * i), y + (dy * i)).empty()) {
+            result.status = ATTACK_LINE_OF_SIGHT_BLOCKED;
+            return result;
+        }
+    }
+
+    // 4. Select first valid target (non-eliminated enemy) in the target square
+    const Cell& targetCell = board.at(targetX, targetY);
+    for (int k = 0; k < targetCell.size(); ++k) {
+        int candidate = targetCell[k];
+        if (players.getTeam(candidate) != team && !players.isEliminated(candidate)) {
+            result.target = candidate;
+            break;
+        }
+    }
+    if (result.target < 0) {
+        result.status = ATTACK_NO_TARGET;
+    }
+    return result;
+}
+
+AttackResult Match::attack(int id, int direction, int squares) {
+    AttackResult result = aimAttack(id, direction, squares);
+    if (!result.fired()) {
+        return result;
+    }
+
+    // 5. Roll where the shot lands: one 32-bit draw against the shooter's table
+    result.location = resolveHit(hitTable[players.getArchetype(id)], randomBits(id, RNG_HIT));
+
+    applyHit(result);
+    return result;
+}
+
+AttackResult Match::resolveAttack(int id, int direction, int squares, HitLocation location) {
+    AttackResult result = aimAttack(id, direction, squares);
+    if (result.fired()) {
+        result.location = location;
+        applyHit(result);
+    }
+    return result;
+}
+
+void Match::applyHit(AttackResult& result) {
+    switch (result.location) {
+        case HIT_HEAD:
+            // Head shots are against the rules: the shooter is the one eliminated
+            eliminate(result.shooter, HEADSHOT_PENALTY);
+            break;
+        case HIT_TORSO:
+            eliminate(result.target, HIT_IN_TORSO);
+            break;
+        case HIT_EXTREMITY:
+            result.extremityHits = static_cast<uint8_t>(players.addExtremityHit(result.target));
+            hash ^= zobristKey(ZOBRIST_EXTREMITY_HITS, result.target, result.extremityHits - 1)
+                    ^ zobristKey(ZOBRIST_EXTREMITY_HITS, result.target, result.extremityHits);
+            if (result.extremityHits >= 3) {
+                eliminate(result.target, THREE_EXTREMITY_HITS);
+            }
+            break;
+        case HIT_MISS:
+            break;
+    }
+}
+
+void resolveHits(const HitThresholds& thresholds, const uint32_t* draws, HitLocation* out, size_t count) {
+    // Copies keep the bounds in registers: `out` could alias them otherwise
+    const uint64_t head = thresholds.head;
+    const uint64_t torso = thresholds.torso;
+    const uint64_t extremity = thresholds.extremity;
+    static const HitLocation byBoundsPassed[4] = {HIT_HEAD, HIT_TORSO, HIT_EXTREMITY, HIT_MISS};
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = byBoundsPassed[(draws[i] >= head) + (draws[i] >= torso) + (draws[i] >= extremity)];
+    }
+}
+
+int hitOutcomesFor(const HitChances& chances, HitOutcome* out) {
+    const HitLocation locations[] = {HIT_HEAD, HIT_TORSO, HIT_EXTREMITY};
+    const double thresholds[] = {chances.head, chances.head + chances.torso,
+                                 chances.head + chances.torso + chances.extremity};
+    int count = 0;
+    double covered = 0;
+    for (int i = 0; i < 3; ++i) {
+        double upTo = min(thresholds[i], 1.0);
+        if (upTo > covered) {
+            out[count++] = {locations[i], upTo - covered};
+            covered = upTo;
+        }
+    }
+    if (covered < 1.0) {
+        out[count++] = {HIT_MISS, 1.0 - covered};
+    }
+    return count;
+}
+
+string describeMove(const MoveResult& result) {
+    switch (result.status) {
+        case MOVE_OK:
+            return "Player " + to_string(result.player) + " moved to (" + to_string(result.toX) + ", " + to_string(result.toY) + ").";
+        case MOVE_TOO_FAR:
+            return "Cannot move " + to_string(result.squares) + " squares. Maximum movement is " + to_string(result.maxMovement) + ".";
+        case MOVE_INVALID_DIRECTION:
+            return "Invalid direction.";
+        case MOVE_OUT_OF_BOUNDS:
+            return "Movement would go out of bounds.";
+        case MOVE_BLOCKED_BY_OPPONENT:
+            return "Cannot move into or through a cell occupied by opponent players.";
+        case MOVE_DESTINATION_FULL:
+            return "Destination cell is full (max 4 players per cell).";
+        case MOVE_INVALID_DISTANCE:
+            return "Cannot move " + to_string(result.squares) + " squares. Players move 1 or 2 squares.";
+    }
+    return "";
+}
+
+string describeAttack(const AttackResult& result) {
+    switch (result.status) {
+        case ATTACK_INVALID_DIRECTION:
+            return "Invalid attack direction. Must be UP(1), LEFT(2), DOWN(3), or RIGHT(4).";
+        case ATTACK_INVALID_RANGE:
+            return string("Invalid attack range. ") + (result.expertShooter ? "Expert players can attack 1-2 squares." : "Novice players can only attack 1 square.");
+        case ATTACK_OUT_OF_BOUNDS:
+            return "Attack target is out of bounds.";
+        case ATTACK_LINE_OF_SIGHT_BLOCKED:
+            return "Line of sight blocked by players in intermediate squares.";
+        case ATTACK_NO_TARGET:
+            return "No valid targets in range.";
+        case ATTACK_FIRED:
+            break;
+    }
+
+    string shooter = to_string(result.shooter);
+    string target = to_string(result.target);
+    switch (result.location) {
+        case HIT_HEAD:
+            return "Player " + shooter + " hit opponent's head and is eliminated due to rule violation!";
+        case HIT_TORSO:
+            return "Player " + shooter + " hit opponent player " + target + "'s torso! Player " + target + " is eliminated!";
+        case HIT_EXTREMITY: {
+            string text = "Player " + shooter + " hit opponent player " + target
+                          + "'s extremity! (" + to_string(result.extremityHits) + "/3 hits)";
+            if (result.extremityHits >= 3) {
+                text += " Player " + target + " received 3 hits to extremities and is eliminated!";
+            }
+            return text;
+        }
+        case HIT_MISS:
+            break;
+    }
+    return "Player " + shooter + " missed the shot.";
+}
+
+int generateLegalActions(const Match& state, int player, Action* out) {
+    const PlayerTable& players = state.getPlayers();
+    if (players.isEliminated(player)) {
+        return 0;
+    }
+
+    const Board& board = state.getBoard();
+    const char team = players.getTeam(player);
+    const int x = players.getX(player);
+    const int y = players.getY(player);
+    const int maxMovement = players.getMaxMovement(player);
+    const int attackRange = players.getAttackRange(player);
+    static const int dxs[] = {0, 0, -1, 0, 1}; // Indexed by Direction
+    static const int dys[] = {0, -1, 0, 1, 0};
+
+    int count = 0;
+    for (int direction = UP; direction <= RIGHT; ++direction) {
+        const int dx = dxs[direction];
+        const int dy = dys[direction];
+
+        // Moves: every cell on the path must be free of opponents, the destination must not be full
+        for (int i = 1; i <= maxMovement; ++i) {
+            int nx = x + dx * i;
+            int ny = y + dy * i;
+            if (!board.inBounds(nx, ny)) break;
+            const Cell& cell = board.at(nx, ny);
+            bool opponentInCell = false;
+            for (int k = 0; k < cell.size(); ++k) {
+                if (players.getTeam(cell[k]) != team) {
+                    opponentInCell = true;
+                    break;
+                }
+            }
+            if (opponentInCell) break;
+            if (!cell.isFull()) {
+                out[count++] = {player, -1, ACTION_MOVE, static_cast<uint8_t>(direction), static_cast<uint8_t>(i)};
+            }
+        }
+
+        // Attacks: the first active opponent in the target cell, with a clear line of sight
+        for (int i = 1; i <= attackRange; ++i) {
+            int tx = x + dx * i;
+            int ty = y + dy * i;
+            if (!board.inBounds(tx, ty)) break;
+            const Cell& cell = board.at(tx, ty);
+            for (int k = 0; k < cell.size(); ++k) {
+                int target = cell[k];
+                if (players.getTeam(target) != team && !players.isEliminated(target)) {
+                    out[count++] = {player, target, ACTION_ATTACK, static_cast<uint8_t>(direction), static_cast<uint8_t>(i)};
+                    break;
+                }
+            }
+            if (!cell.empty()) break; // Anyone in this cell blocks shots further away
+        }
+    }
+    return count;
+}
+
+void generateTeamActions(const Match& state, char team, vector<Action>& out) {
+    Action buffer[MAX_PLAYER_ACTIONS];
+    for (int player = state.teamBegin(team); player < state.teamEnd(team); ++player) {
+        int count = generateLegalActions(state, player, buffer);
+        out.insert(out.end(), buffer, buffer + count);
+    }
+}
+
+void applyAction(Match& state, const Action& action) {
+    if (action.kind == ACTION_MOVE) {
+        state.move(action.player, action.direction, action.distance);
+    } else {
+        state.attack(action.player, action.direction, action.distance);
+    }
+}
+
+double evaluateForTeam(const Match& state, char team) {
+    MatchOutcome outcome = state.checkEndConditions();
+    if (outcome.reason != NOT_ENDED) {
+        return outcome.winner == team ? 1.0 : 0.0;
+    }
+
+    // Material: share of the remaining players
+    const TeamStats& mine = state.getTeamStats(team);
+    const TeamStats& theirs = state.getTeamStats(opponentOf(team));
+    double material = static_cast<double>(mine.active - theirs.active) / (mine.active + theirs.active);
+
+    // Progress: how close each side's lead runner is to the enemy flag
+    double span = state.getRows() + state.getCols();
+    int myDistance = closestToFlag(state, team, state.getFlag(opponentOf(team)));
+    int theirDistance = closestToFlag(state, opponentOf(team), state.getFlag(team));
+    double progress = (theirDistance - myDistance) / span;
+
+    return 0.5 + 0.3 * material + 0.2 * progress;
+}
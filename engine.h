@@ -0,0 +1,394 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rng.h"
+
+// Game rules shared by the interactive game and headless matches.
+// Nothing in here touches the terminal, audio or global state, so any
+// number of matches can live in the same process.
+
+// Direction enum for clarity
+enum Direction { UP = 1, LEFT, DOWN, RIGHT };
+
+// A board cell holds at most 4 players. Their indices are stored inline in
+// arrival order, so moving a player never touches the heap.
+class Cell {
+public:
+    static const int CAPACITY = 4;
+private:
+    int32_t players[CAPACITY];
+    uint8_t count;
+public:
+    Cell() : count(0) {}
+    bool addPlayer(int index);
+    void insertPlayer(int index, int slot); // Cell must not be full
+    void removePlayer(int index);
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool isFull() const { return count >= CAPACITY; }
+    int operator[](int slot) const { return players[slot]; }
+};
+
+// Row-major grid of cells in a single allocation
+class Board {
+private:
+    int rows;
+    int cols;
+    std::vector<Cell> cells;
+public:
+    Board() : rows(0), cols(0) {}
+    void resize(int numRows, int numCols);
+    int getRows() const { return rows; }
+    int getCols() const { return cols; }
+    bool inBounds(int x, int y) const { return x >= 0 && y >= 0 && x < cols && y < rows; }
+    Cell& at(int x, int y) { return cells[y * cols + x]; }
+    const Cell& at(int x, int y) const { return cells[y * cols + x]; }
+};
+
+// Archetype bits stored for every player
+enum ArchetypeFlags : uint8_t { ARCH_FAST = 1, ARCH_EXPERT = 2 };
+
+// Why a player left the match (NOT_ELIMINATED while still playing)
+enum EliminationReason : uint8_t { NOT_ELIMINATED = 0, HIT_IN_TORSO, THREE_EXTREMITY_HITS, HEADSHOT_PENALTY };
+
+const char* eliminationReasonText(EliminationReason reason);
+
+// Hit probabilities of a shot, decided by the shooter's expertise
+struct HitChances {
+    double head;
+    double torso;
+    double extremity;
+};
+
+// Tunable parameters of a match; the defaults are the standard game
+struct Rules {
+    // Cumulative thresholds of the archetype draw when a player is placed:
+    // fast expert below the first, slow expert below the second, fast novice
+    // below the third and slow novice above it
+    double fastExpertBelow = 0.15;
+    double slowExpertBelow = 0.40;
+    double fastNoviceBelow = 0.90;
+    HitChances expert = {0.05, 0.6, 0.85};
+    HitChances novice = {0.25, 0.1, 0.5};
+    constexpr const HitChances& hitChancesFor(bool isExpert) const { return isExpert ? expert : novice; }
+};
+
+// Structure-of-arrays player store. A player ID is the index into every
+// array, and each team occupies a contiguous range of IDs.
+class PlayerTable {
+private:
+    std::vector<int32_t> xs, ys; // Position on the board
+    std::vector<int32_t> startXs, startYs;
+    std::vector<char> teams; // 'R' for Red, 'B' for Blue
+    std::vector<uint8_t> archetypes; // ArchetypeFlags
+    std::vector<uint8_t> extremityHits;
+    std::vector<uint8_t> eliminationReasons; // EliminationReason
+    std::vector<uint32_t> movedRounds; // Round in which the player last acted
+    uint32_t round;
+public:
+    PlayerTable() : round(1) {}
+    void reserve(size_t count);
+    int add(char team, bool fast, bool expert, int x, int y);
+    int size() const { return static_cast<int>(teams.size()); }
+    char getTeam(int id) const { return teams[id]; }
+    int getX(int id) const { return xs[id]; }
+    int getY(int id) const { return ys[id]; }
+    void setPosition(int id, int x, int y) { xs[id] = x; ys[id] = y; }
+    std::pair<int, int> getStartPosition(int id) const { return {startXs[id], startYs[id]}; }
+    uint8_t getArchetype(int id) const { return archetypes[id]; }
+    bool isFast(int id) const { return (archetypes[id] & ARCH_FAST) != 0; }
+    bool isExpert(int id) const { return (archetypes[id] & ARCH_EXPERT) != 0; }
+    int getMaxMovement(int id) const { return isFast(id) ? 2 : 1; }
+    int getAttackRange(int id) const { return isExpert(id) ? 2 : 1; }
+    int getHitsToExtremities(int id) const { return extremityHits[id]; }
+    uint32_t getMovedRound(int id) const { return movedRounds[id]; }
+    int addExtremityHit(int id) { return ++extremityHits[id]; }
+    bool isEliminated(int id) const { return eliminationReasons[id] != NOT_ELIMINATED; }
+    EliminationReason getEliminationReason(int id) const { return static_cast<EliminationReason>(eliminationReasons[id]); }
+    void setEliminated(int id, EliminationReason reason) { eliminationReasons[id] = reason; }
+    bool hasMoved(int id) const { return movedRounds[id] == round; }
+    void setMoved(int id) { movedRounds[id] = round; }
+    void resetMoved() { ++round; } // Starts a new round: nobody has moved in it yet
+    uint32_t getRound() const { return round; }
+    // Overwrites the mutable state of a player, for Match::restoreSnapshot()
+    void restore(int id, int x, int y, int hits, EliminationReason reason, uint32_t movedRound);
+    void setRound(uint32_t newRound) { round = newRound; }
+};
+
+inline int teamIndex(char team) { return team == 'R' ? 0 : 1; }
+inline char opponentOf(char team) { return team == 'R' ? 'B' : 'R'; }
+
+// Per-team counters kept up to date by every move and elimination, so the
+// end conditions and the stats panel never have to scan the roster
+struct TeamStats {
+    int active; // Players not eliminated
+    int unmoved; // Active players that have not acted this round
+    int onFlag[2]; // Active players standing on the red (0) / blue (1) flag cell
+    std::vector<int32_t> eliminated; // IDs in elimination order
+};
+
+// How a match ended (NOT_ENDED while it is still being played)
+enum EndReason { NOT_ENDED = 0, FLAG_CAPTURED, TEAM_ELIMINATED, RETREAT };
+
+struct MatchOutcome {
+    EndReason reason;
+    char winner; // 'R' or 'B', only meaningful when reason != NOT_ENDED
+};
+
+// Outcome of Match::move(). Text is only built on request by describeMove().
+enum MoveStatus : uint8_t {
+    MOVE_OK = 0,
+    MOVE_TOO_FAR,
+    MOVE_INVALID_DIRECTION,
+    MOVE_OUT_OF_BOUNDS,
+    MOVE_BLOCKED_BY_OPPONENT,
+    MOVE_DESTINATION_FULL,
+    MOVE_INVALID_DISTANCE // Neither 1, 2 nor -1 (random)
+};
+
+struct MoveResult {
+    MoveStatus status;
+    int32_t player;
+    int32_t squares; // Squares requested (after resolving a random -1)
+    int32_t maxMovement;
+    int32_t fromX, fromY;
+    int32_t toX, toY; // Same as from unless the move succeeded
+    bool ok() const { return status == MOVE_OK; }
+};
+
+// Outcome of Match::attack(). ATTACK_FIRED means a shot was taken at `target`
+// and `location` says where it landed; every other status is a rejected attack.
+enum AttackStatus : uint8_t {
+    ATTACK_FIRED = 0,
+    ATTACK_INVALID_DIRECTION,
+    ATTACK_INVALID_RANGE,
+    ATTACK_OUT_OF_BOUNDS,
+    ATTACK_LINE_OF_SIGHT_BLOCKED,
+    ATTACK_NO_TARGET
+};
+
+enum HitLocation : uint8_t { HIT_MISS = 0, HIT_HEAD, HIT_TORSO, HIT_EXTREMITY };
+
+struct AttackResult {
+    AttackStatus status;
+    HitLocation location;
+    bool expertShooter;
+    uint8_t extremityHits; // Target's total after an extremity hit
+    int32_t shooter;
+    int32_t target; // -1 when no shot was fired
+    bool fired() const { return status == ATTACK_FIRED; }
+    bool hit() const { return status == ATTACK_FIRED && location != HIT_MISS; }
+};
+
+// A shot resolved from one raw 32-bit draw: it hits the head below `head`,
+// the torso below `torso`, an extremity below `extremity` and misses above.
+// The bounds are cumulative chances scaled by 2^32 and capped at 2^32, which
+// is why they need 64 bits (the expert chances add up to more than 1).
+struct HitThresholds {
+    uint64_t head;
+    uint64_t torso;
+    uint64_t extremity;
+};
+
+constexpr uint64_t scaleHitChance(double cumulative) {
+    return cumulative <= 0.0 ? 0
+         : cumulative >= 1.0 ? (1ull << 32)
+         : static_cast<uint64_t>(cumulative * 4294967296.0 + 0.5);
+}
+
+constexpr HitThresholds hitThresholdsFor(const HitChances& chances) {
+    return {scaleHitChance(chances.head),
+            scaleHitChance(chances.head + chances.torso),
+            scaleHitChance(chances.head + chances.torso + chances.extremity)};
+}
+
+// Branch-free: the number of bounds at or below the draw picks the outcome
+inline HitLocation resolveHit(const HitThresholds& thresholds, uint32_t draw) {
+    static const HitLocation byBoundsPassed[4] = {HIT_HEAD, HIT_TORSO, HIT_EXTREMITY, HIT_MISS};
+    int passed = (draw >= thresholds.head) + (draw >= thresholds.torso) + (draw >= thresholds.extremity);
+    return byBoundsPassed[passed];
+}
+
+// Tables of the standard rules, built at compile time for each archetype
+template <uint8_t Archetype>
+struct StandardHitTable {
+    static constexpr HitThresholds value = hitThresholdsFor(Rules().hitChancesFor((Archetype & ARCH_EXPERT) != 0));
+};
+
+template <uint8_t Archetype>
+inline HitLocation resolveStandardHit(uint32_t draw) {
+    return resolveHit(StandardHitTable<Archetype>::value, draw);
+}
+
+// Resolves `count` shots of one archetype at once, for simulations
+void resolveHits(const HitThresholds& thresholds, const uint32_t* draws, HitLocation* out, size_t count);
+
+template <uint8_t Archetype>
+inline void resolveStandardHits(const uint32_t* draws, HitLocation* out, size_t count) {
+    resolveHits(StandardHitTable<Archetype>::value, draws, out, count);
+}
+
+// One way a fired shot can end and its probability. The chances of a roll
+// are cumulative thresholds, so an outcome only gets what is left below 1.
+struct HitOutcome {
+    HitLocation location;
+    double probability;
+};
+
+const int MAX_HIT_OUTCOMES = 4;
+
+// Writes the outcomes with a non-zero probability into `out` (which must hold
+// MAX_HIT_OUTCOMES entries) and returns how many there are
+int hitOutcomesFor(const HitChances& chances, HitOutcome* out);
+
+std::string describeMove(const MoveResult& result);
+std::string describeAttack(const AttackResult& result);
+
+// A single legal option for one player, as produced by generateLegalActions()
+enum ActionKind : uint8_t { ACTION_MOVE = 0, ACTION_ATTACK };
+
+struct Action {
+    int32_t player;
+    int32_t target; // Player that would be shot (attacks only, -1 for moves)
+    uint8_t kind; // ActionKind
+    uint8_t direction; // Direction
+    uint8_t distance; // Squares moved or attack range
+};
+
+// Everything that changes after setup(): where each player stands (and in
+// which slot of its cell), its hits, elimination and last round played, plus
+// the elimination order. Replay keyframes are built from it.
+struct MatchSnapshot {
+    uint32_t round;
+    std::vector<int32_t> xs, ys;
+    std::vector<uint8_t> slots;
+    std::vector<uint8_t> extremityHits;
+    std::vector<uint8_t> eliminationReasons; // EliminationReason
+    std::vector<uint32_t> movedRounds;
+    std::vector<int32_t> eliminated[2]; // By teamIndex()
+};
+
+// What one reversible change (Match::make*()) overwrote, so unmake() can put
+// it back without copying the match: the actor's fields, the team counters,
+// the round and the hash. A shot's target needs no copy, since it was active
+// before and only its hits and elimination can have changed.
+struct UndoEntry {
+    uint64_t hash;
+    uint32_t round;
+    int32_t actor; // -1 for a new round
+    int32_t target; // Player that was shot, -1 if no shot was fired
+    HitLocation location;
+    uint8_t slot; // Actor's place in its cell
+    uint8_t extremityHits;
+    uint8_t eliminationReason;
+    int32_t x, y;
+    uint32_t movedRound;
+    int32_t active[2];
+    int32_t unmoved[2];
+    int32_t onFlag[2][2];
+    uint32_t eliminatedCount[2];
+};
+
+// Largest setup the front ends and the replay reader accept; far beyond a
+// playable board, it keeps a mistyped or corrupt size from exhausting memory
+const int MAX_BOARD_SIDE = 1000;
+const int MAX_PLAYERS_PER_TEAM = 100000;
+
+inline bool isValidSetup(int rows, int cols, int playersPerTeam) {
+    return rows > 0 && rows <= MAX_BOARD_SIDE && cols > 0 && cols <= MAX_BOARD_SIDE && playersPerTeam > 0
+        && playersPerTeam <= MAX_PLAYERS_PER_TEAM;
+}
+
+// Board, teams and flags of a single match
+class Match {
+private:
+    int numPlayersPerTeam;
+    Rules rules;
+    Board board;
+    PlayerTable players; // Red IDs come first, then Blue
+    int redCount;
+    std::pair<int, int> redFlag;
+    std::pair<int, int> blueFlag;
+    TeamStats teamStats[2];
+    HitThresholds hitTable[4]; // By archetype, from the rules
+    uint64_t seed;
+    CounterRng rng; // Draws are keyed by (seed, round, player, stream)
+    uint64_t hash; // Zobrist hash of positions, extremity hits and eliminations
+    AttackResult aimAttack(int id, int direction, int squares);
+    void applyHit(AttackResult& result);
+    void markMoved(int id);
+    void eliminate(int id, EliminationReason reason);
+    void updateFlagCounts(int id, int x, int y, int delta);
+    void pushUndo(int actor, std::vector<UndoEntry>& undo) const;
+public:
+    explicit Match(uint64_t seed, const Rules& rules = Rules());
+    void setup(int rows, int cols, int playersPerTeam);
+    int getRows() const { return board.getRows(); }
+    int getCols() const { return board.getCols(); }
+    int getPlayersPerTeam() const { return numPlayersPerTeam; }
+    const Rules& getRules() const { return rules; }
+    Board& getBoard() { return board; }
+    const Board& getBoard() const { return board; }
+    PlayerTable& getPlayers() { return players; }
+    const PlayerTable& getPlayers() const { return players; }
+    int teamBegin(char team) const { return team == 'R' ? 0 : redCount; }
+    int teamEnd(char team) const { return team == 'R' ? redCount : players.size(); }
+    std::pair<int, int> getFlag(char team) const { return team == 'R' ? redFlag : blueFlag; }
+    const TeamStats& getTeamStats(char team) const { return teamStats[teamIndex(team)]; }
+    uint64_t getSeed() const { return seed; }
+    void reseed(uint64_t newSeed) { seed = newSeed; rng = CounterRng(newSeed); }
+    // Uniform in [0, 1), fixed by the seed, the current round, `player` and `stream`
+    double random(int player, RandomStream stream) const { return rng.uniform(players.getRound(), player, stream); }
+    uint32_t randomBits(int player, RandomStream stream) const {
+        return static_cast<uint32_t>(rng.draw(players.getRound(), player, stream) >> 32);
+    }
+    MoveResult move(int id, int direction, int squares);
+    AttackResult attack(int id, int direction, int squares);
+    // Same as attack() with an explicit range, but the shot lands at `location`
+    // instead of being rolled. Lets a search walk every chance outcome.
+    AttackResult resolveAttack(int id, int direction, int squares, HitLocation location);
+    void resetPlayersMovedFlag();
+    MatchOutcome checkEndConditions() const;
+    // Kept up to date by every move, hit and elimination. Moved flags, the RNG
+    // and the side to move are not part of it.
+    uint64_t getHash() const { return hash; }
+    uint64_t computeHash() const; // From scratch, for verification
+    void saveSnapshot(MatchSnapshot& out) const;
+    // Onto a match set up with the same seed, rules and size. Team counters
+    // and the hash are rebuilt from the snapshot.
+    void restoreSnapshot(const MatchSnapshot& snapshot);
+    // Reversible move(), attack(), resolveAttack() and resetPlayersMovedFlag():
+    // each pushes what it overwrites onto `undo`, and unmake() reverts the
+    // latest one. Rolling back costs a few dozen bytes instead of a copy.
+    MoveResult makeMove(int id, int direction, int squares, std::vector<UndoEntry>& undo);
+    AttackResult makeAttack(int id, int direction, int squares, std::vector<UndoEntry>& undo);
+    AttackResult makeResolvedAttack(int id, int direction, int squares, HitLocation location,
+                                    std::vector<UndoEntry>& undo);
+    void makeNewRound(std::vector<UndoEntry>& undo);
+    void unmake(std::vector<UndoEntry>& undo);
+};
+
+// Upper bound of actions one player can have: 4 directions x (2 moves + 2 attacks)
+const int MAX_PLAYER_ACTIONS = 16;
+
+// Writes every legal move and attack of `player` into `out` (which must hold
+// MAX_PLAYER_ACTIONS entries) and returns how many were written. Pure query:
+// no RNG draws, no allocation and the match is left untouched.
+int generateLegalActions(const Match& state, int player, Action* out);
+
+// Appends the legal actions of every active player of `team` to `out`
+void generateTeamActions(const Match& state, char team, std::vector<Action>& out);
+
+// Plays a generated action through move()/attack(); attacks roll the match RNG
+void applyAction(Match& state, const Action& action);
+
+// Result of a finished match, or a heuristic estimate of an unfinished one,
+// as a win probability for `team` in [0, 1]
+double evaluateForTeam(const Match& state, char team);
+
+#endif
@@ -0,0 +1,347 @@
+#include "expectimax.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Xored into the hash when Blue is to move
+const uint64_t SIDE_TO_MOVE_KEY = 0xD1B54A32D192ED03ull;
+
+// Entry layout inside the 64-bit data word
+const int VALUE_BITS = 16;
+const double VALUE_SCALE = (1 << VALUE_BITS) - 1;
+const int DEPTH_SHIFT = 16;
+const int BOUND_SHIFT = 24;
+const int HAS_MOVE_SHIFT = 26;
+const int PLAYER_SHIFT = 27;
+const int KIND_SHIFT = 43;
+const int DIRECTION_SHIFT = 44;
+const int DISTANCE_SHIFT = 47;
+
+uint64_t packEntry(const TranspositionTable::Entry& entry) {
+    uint64_t data = static_cast<uint64_t>(lround(clamp(entry.value, 0.0, 1.0) * VALUE_SCALE));
+    data |= static_cast<uint64_t>(min(entry.depth, 255)) << DEPTH_SHIFT;
+    data |= static_cast<uint64_t>(entry.bound) << BOUND_SHIFT;
+    if (entry.hasMove && entry.move.player < (1 << 16)) {
+        data |= 1ull << HAS_MOVE_SHIFT;
+        data |= static_cast<uint64_t>(entry.move.player) << PLAYER_SHIFT;
+        data |= static_cast<uint64_t>(entry.move.kind & 1) << KIND_SHIFT;
+        data |= static_cast<uint64_t>(entry.move.direction & 7) << DIRECTION_SHIFT;
+        data |= static_cast<uint64_t>(entry.move.distance & 3) << DISTANCE_SHIFT;
+    }
+    return data;
+}
+
+TranspositionTable::Entry unpackEntry(uint64_t data) {
+    TranspositionTable::Entry entry;
+    entry.value = (data & 0xFFFF) / VALUE_SCALE;
+    entry.depth = static_cast<int>((data >> DEPTH_SHIFT) & 0xFF);
+    entry.bound = static_cast<TranspositionTable::Bound>((data >> BOUND_SHIFT) & 3);
+    entry.hasMove = ((data >> HAS_MOVE_SHIFT) & 1) != 0;
+    entry.move.player = static_cast<int32_t>((data >> PLAYER_SHIFT) & 0xFFFF);
+    entry.move.target = -1;
+    entry.move.kind = static_cast<uint8_t>((data >> KIND_SHIFT) & 1);
+    entry.move.direction = static_cast<uint8_t>((data >> DIRECTION_SHIFT) & 7);
+    entry.move.distance = static_cast<uint8_t>((data >> DISTANCE_SHIFT) & 3);
+    return entry;
+}
+
+bool sameAction(const Action& a, const Action& b) {
+    return a.player == b.player && a.kind == b.kind && a.direction == b.direction && a.distance == b.distance;
+}
+
+// One search thread. All workers share the table and the stop flag.
+struct Worker {
+    TranspositionTable& table;
+    chrono::steady_clock::time_point deadline;
+    atomic<bool>& stop;
+    const atomic<bool>* cancel; // Set from outside the search, may be null
+    long long nodes = 0;
+    long long tableHits = 0;
+    vector<uint64_t> line; // Keys of the positions from the root to the current node
+    vector<vector<Action>> actionLists; // Scratch per ply
+    vector<UndoEntry> undo; // Children are made and unmade in place
+    Action rootBest = Action();
+    bool hasRootBest = false;
+
+    // Results of the deepest iteration this worker completed
+    int completedDepth = 0;
+    Action bestAction = Action();
+    double bestValue = 0.5;
+
+    Worker(TranspositionTable& table, chrono::steady_clock::time_point deadline, atomic<bool>& stop,
+           const atomic<bool>* cancel)
+        : table(table), deadline(deadline), stop(stop), cancel(cancel) {}
+
+    bool outOfTime() {
+        if ((++nodes & 1023) == 0 && (chrono::steady_clock::now() >= deadline
+                                      || (cancel && cancel->load(memory_order_relaxed)))) {
+            stop.store(true, memory_order_relaxed);
+        }
+        return stop.load(memory_order_relaxed);
+    }
+
+    // Value of `state` for `toMove` in [0, 1], fail-soft within (alpha, beta)
+    double search(Match& state, char toMove, int depth, double alpha, double beta, size_t ply) {
+        if (outOfTime()) {
+            return 0.5; // Discarded by the caller
+        }
+        MatchOutcome outcome = state.checkEndConditions();
+        if (outcome.reason != NOT_ENDED) {
+            return outcome.winner == toMove ? 1.0 : 0.0;
+        }
+
+        uint64_t key = state.getHash() ^ (toMove == 'B' ? SIDE_TO_MOVE_KEY : 0);
+        if (depth == 0 || find(line.begin(), line.end(), key) != line.end()) {
+            return evaluateForTeam(state, toMove); // Horizon, or a position already on this line
+        }
+
+        TranspositionTable::Entry entry;
+        bool found = table.probe(key, entry);
+        if (found && entry.depth >= depth && ply > 0) {
+            if (entry.bound == TranspositionTable::BOUND_EXACT
+                || (entry.bound == TranspositionTable::BOUND_LOWER && entry.value >= beta)
+                || (entry.bound == TranspositionTable::BOUND_UPPER && entry.value <= alpha)) {
+                tableHits++;
+                return entry.value;
+            }
+        }
+
+        if (actionLists.size() <= ply) {
+            actionLists.resize(ply + 1);
+        }
+        vector<Action>& actions = actionLists[ply];
+        actions.clear();
+        generateTeamActions(state, toMove, actions);
+
+        line.push_back(key);
+        if (actions.empty()) {
+            // Nobody can act: the turn passes to the other team
+            double value = 1.0 - search(state, opponentOf(toMove), depth - 1, 1.0 - beta, 1.0 - alpha, ply + 1);
+            line.pop_back();
+            return value;
+        }
+
+        // Best action from an earlier search first, then shots, then moves
+        stable_partition(actions.begin(), actions.end(), [](const Action& a) { return a.kind == ACTION_ATTACK; });
+        if (found && entry.hasMove) {
+            auto hit = find_if(actions.begin(), actions.end(), [&](const Action& a) { return sameAction(a, entry.move); });
+            if (hit != actions.end()) {
+                rotate(actions.begin(), hit, hit + 1);
+            }
+        }
+
+        const double originalAlpha = alpha;
+        double best = -1.0;
+        Action bestAction = actions[0];
+        // `actions` may be reallocated by deeper plies, so index instead of iterating
+        for (size_t i = 0; i < actionLists[ply].size(); ++i) {
+            Action action = actionLists[ply][i];
+            double value = action.kind == ACTION_ATTACK
+                ? chanceValue(state, action, toMove, depth, alpha, beta, ply)
+                : moveValue(state, action, toMove, depth, alpha, beta, ply);
+            if (stop.load(memory_order_relaxed)) {
+                line.pop_back();
+                return 0.5;
+            }
+            if (value > best) {
+                best = value;
+                bestAction = action;
+            }
+            alpha = max(alpha, value);
+            if (alpha >= beta) {
+                break;
+            }
+        }
+        line.pop_back();
+
+        TranspositionTable::Bound bound = best <= originalAlpha ? TranspositionTable::BOUND_UPPER
+                                        : best >= beta ? TranspositionTable::BOUND_LOWER
+                                        : TranspositionTable::BOUND_EXACT;
+        table.store(key, {best, depth, bound, true, bestAction});
+        if (ply == 0) {
+            rootBest = bestAction;
+            hasRootBest = true;
+        }
+        return best;
+    }
+
+    double moveValue(Match& state, const Action& action, char mover, int depth,
+                     double alpha, double beta, size_t ply) {
+        state.makeNewRound(undo);
+        state.makeMove(action.player, action.direction, action.distance, undo);
+        double value = 1.0 - search(state, opponentOf(mover), depth - 1, 1.0 - beta, 1.0 - alpha, ply + 1);
+        state.unmake(undo);
+        state.unmake(undo);
+        return value;
+    }
+
+    // Expected value of a shot for `mover`. Star1: each outcome is searched
+    // with the narrowest window that can still move the average across
+    // (alpha, beta), assuming the unsearched outcomes are all 0 or all 1.
+    double chanceValue(Match& state, const Action& action, char mover, int depth,
+                       double alpha, double beta, size_t ply) {
+        HitOutcome outcomes[MAX_HIT_OUTCOMES];
+        int count = hitOutcomesFor(state.getRules().hitChancesFor(state.getPlayers().isExpert(action.player)), outcomes);
+        double sum = 0;
+        double remaining = 1.0;
+        for (int i = 0; i < count; ++i) {
+            double p = outcomes[i].probability;
+            remaining = max(0.0, remaining - p);
+            double low = (alpha - sum - remaining) / p; // At or below: the average stays <= alpha
+            double high = (beta - sum) / p; // At or above: the average reaches beta
+            if (low >= 1.0) {
+                return sum + p + remaining;
+            }
+            if (high <= 0.0) {
+                return sum;
+            }
+
+            state.makeNewRound(undo);
+            state.makeResolvedAttack(action.player, action.direction, action.distance, outcomes[i].location, undo);
+            double childAlpha = max(low, 0.0);
+            double childBeta = min(high, 1.0);
+            double value = 1.0 - search(state, opponentOf(mover), depth - 1, 1.0 - childBeta, 1.0 - childAlpha, ply + 1);
+            state.unmake(undo);
+            state.unmake(undo);
+            if (stop.load(memory_order_relaxed)) {
+                return 0.5;
+            }
+            if (value <= low) {
+                return sum + p * value + remaining;
+            }
+            if (value >= high) {
+                return sum + p * value;
+            }
+            sum += p * value;
+        }
+        return sum;
+    }
+
+    void run(const Match& root, char team, int firstDepth, int step, int maxDepth) {
+        Match state = root; // The only copy: the search works on it in place
+        for (int depth = firstDepth; depth <= maxDepth; depth += step) {
+            hasRootBest = false;
+            double value = search(state, team, depth, 0.0, 1.0, 0);
+            if (stop.load(memory_order_relaxed) || !hasRootBest) {
+                break;
+            }
+            completedDepth = depth;
+            bestAction = rootBest;
+            bestValue = value;
+            if (value <= 0.0 || value >= 1.0) {
+                break; // Result is forced, searching deeper cannot change it
+            }
+        }
+    }
+};
+
+} // namespace
+
+TranspositionTable::TranspositionTable(int bits)
+    : slots(new Slot[static_cast<size_t>(1) << bits]), mask((static_cast<uint64_t>(1) << bits) - 1) {
+    clear();
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry& entry) const {
+    const Slot& slot = slots[key & mask];
+    uint64_t data = slot.data.load(memory_order_relaxed);
+    uint64_t check = slot.check.load(memory_order_relaxed);
+    if ((check ^ data) != key || data == 0) {
+        return false;
+    }
+    entry = unpackEntry(data);
+    return entry.bound != BOUND_NONE;
+}
+
+void TranspositionTable::store(uint64_t key, const Entry& entry) {
+    Slot& slot = slots[key & mask];
+    uint64_t oldData = slot.data.load(memory_order_relaxed);
+    uint64_t oldCheck = slot.check.load(memory_order_relaxed);
+    if ((oldCheck ^ oldData) == key && unpackEntry(oldData).depth > entry.depth) {
+        return;
+    }
+    uint64_t data = packEntry(entry);
+    slot.check.store(key ^ data, memory_order_relaxed);
+    slot.data.store(data, memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    for (uint64_t i = 0; i <= mask; ++i) {
+        slots[i].check.store(0, memory_order_relaxed);
+        slots[i].data.store(0, memory_order_relaxed);
+    }
+}
+
+ExpectimaxSearch::ExpectimaxSearch(const ExpectimaxConfig& config) : config(config) {}
+
+bool ExpectimaxSearch::chooseAction(const Match& state, char team, Action& best, const atomic<bool>* cancel) {
+    auto start = chrono::steady_clock::now();
+    stats = ExpectimaxStats();
+
+    vector<Action> legal;
+    generateTeamActions(state, team, legal);
+    if (legal.empty()) {
+        return false;
+    }
+    if (legal.size() == 1) {
+        best = legal[0];
+        return true;
+    }
+    if (!table) {
+        table.reset(new TranspositionTable(config.tableBits));
+    }
+
+    int threadCount = config.threads > 0 ? config.threads : static_cast<int>(thread::hardware_concurrency());
+    threadCount = max(1, threadCount);
+    auto deadline = start + chrono::milliseconds(config.budgetMs);
+    atomic<bool> stop(false);
+
+    // Lazy SMP: helpers run their own iterative deepening, half of them one
+    // ply ahead, and profit from each other only through the shared table
+    vector<Worker> workers;
+    workers.reserve(threadCount);
+    for (int t = 0; t < threadCount; ++t) {
+        workers.emplace_back(*table, deadline, stop, cancel);
+    }
+    vector<thread> helpers;
+    for (int t = 1; t < threadCount; ++t) {
+        helpers.emplace_back(&Worker::run, &workers[t], cref(state), team, 1 + t % 2, 1, config.maxDepth);
+    }
+    workers[0].run(state, team, 1, 1, config.maxDepth);
+    stop.store(true);
+    for (thread& helper : helpers) {
+        helper.join();
+    }
+
+    // Shots first if not even one iteration finished in time
+    auto shot = find_if(legal.begin(), legal.end(), [](const Action& a) { return a.kind == ACTION_ATTACK; });
+    best = shot != legal.end() ? *shot : legal[0];
+    const Worker* deepest = nullptr;
+    for (const Worker& worker : workers) {
+        stats.nodes += worker.nodes;
+        stats.tableHits += worker.tableHits;
+        if (worker.completedDepth > 0 && (!deepest || worker.completedDepth > deepest->completedDepth)) {
+            deepest = &worker;
+        }
+    }
+    if (deepest) {
+        // The stored action has no target; take the generated one
+        for (const Action& action : legal) {
+            if (sameAction(action, deepest->bestAction)) {
+                best = action;
+            }
+        }
+        stats.depth = deepest->completedDepth;
+        stats.value = deepest->bestValue;
+    }
+
+    stats.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef EXPECTIMAX_H
+#define EXPECTIMAX_H
+
+#include <atomic>
+#include <memory>
+
+#include "engine.h"
+
+// Expectiminimax opponent. Decision plies alternate between the teams, and
+// every attack that fires becomes a chance node over the outcomes of
+// hitOutcomesFor(), pruned with Star1 bounds. Iterative deepening runs until
+// a wall-clock deadline on several threads that share one lock-free
+// transposition table (lazy SMP). The table is keyed by Match::getHash() and
+// the side to move, so positions reached again by units shuffling back and
+// forth are looked up instead of searched again.
+
+struct ExpectimaxConfig {
+    int budgetMs = 200; // Wall-clock time per decision
+    int threads = 0; // 0 = one per hardware thread
+    int maxDepth = 32; // Decision plies
+    int tableBits = 20; // The table holds 2^tableBits entries of 16 bytes
+};
+
+struct ExpectimaxStats {
+    int depth = 0; // Deepest completed iteration
+    long long nodes = 0;
+    long long tableHits = 0; // Probes that ended a node without searching it
+    double elapsedMs = 0;
+    double value = 0.5; // Expected result for the searching team
+};
+
+// Fixed-size table shared by all search threads without locks. A slot holds
+// key ^ data next to data, so a slot torn by two concurrent writers fails the
+// key check on the next probe instead of returning another position's data.
+class TranspositionTable {
+public:
+    enum Bound : uint8_t { BOUND_NONE = 0, BOUND_EXACT, BOUND_LOWER, BOUND_UPPER };
+    struct Entry {
+        double value; // For the side to move
+        int depth;
+        Bound bound;
+        bool hasMove;
+        Action move; // Best action found; its target is not stored
+    };
+private:
+    struct Slot {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask;
+public:
+    explicit TranspositionTable(int bits);
+    bool probe(uint64_t key, Entry& entry) const;
+    void store(uint64_t key, const Entry& entry); // Keeps a deeper entry of the same position
+    void clear();
+};
+
+class ExpectimaxSearch {
+private:
+    ExpectimaxConfig config;
+    ExpectimaxStats stats;
+    std::unique_ptr<TranspositionTable> table; // Allocated on first use, kept between decisions
+public:
+    explicit ExpectimaxSearch(const ExpectimaxConfig& config = ExpectimaxConfig());
+    // Picks an action for `team` in `state`. Returns false if it has none.
+    // Setting `cancel` ends the search early with the best action so far.
+    bool chooseAction(const Match& state, char team, Action& best, const std::atomic<bool>* cancel = nullptr);
+    const ExpectimaxStats& getLastStats() const { return stats; }
+    const ExpectimaxConfig& getConfig() const { return config; }
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "flowfield.h"
+
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+const int32_t FlowField::UNREACHABLE;
+const int32_t FlowField::ENEMY_STEP_COST;
+
+int FlowField::neighborsOf(int index, int* out) const {
+    int x = index % cols, y = index / cols;
+    int count = 0;
+    if (y > 0) out[count++] = index - cols;
+    if (x > 0) out[count++] = index - 1;
+    if (y + 1 < rows) out[count++] = index + cols;
+    if (x + 1 < cols) out[count++] = index + 1;
+    return count;
+}
+
+int32_t FlowField::bestNeighborDistance(int index) const {
+    int neighbors[4];
+    int count = neighborsOf(index, neighbors);
+    int32_t best = UNREACHABLE;
+    for (int i = 0; i < count; ++i) {
+        best = min(best, distances[neighbors[i]]);
+    }
+    return best;
+}
+
+bool FlowField::isBlockedFor(const Match& state, int x, int y) const {
+    const Cell& cell = state.getBoard().at(x, y);
+    const PlayerTable& players = state.getPlayers();
+    for (int k = 0; k < cell.size(); ++k) {
+        if (players.getTeam(cell[k]) != team) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FlowField::pushEntry(int32_t distance, int cell) {
+    heap.push_back({distance, cell});
+    push_heap(heap.begin(), heap.end(), greater<Entry>());
+}
+
+FlowField::Entry FlowField::popEntry() {
+    pop_heap(heap.begin(), heap.end(), greater<Entry>());
+    Entry top = heap.back();
+    heap.pop_back();
+    return top;
+}
+
+void FlowField::build(const Match& state, char fieldTeam, pair<int, int> targetCell) {
+    rows = state.getRows();
+    cols = state.getCols();
+    team = fieldTeam;
+    target = targetCell.second * cols + targetCell.first;
+    distances.assign(static_cast<size_t>(rows) * cols, UNREACHABLE);
+    blocked.assign(static_cast<size_t>(rows) * cols, 0);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            blocked[y * cols + x] = isBlockedFor(state, x, y);
+        }
+    }
+    distances[target] = 0;
+    lowerFrom(target);
+}
+
+void FlowField::relax() {
+    while (!heap.empty()) {
+        Entry top = popEntry();
+        if (top.first != distances[top.second]) continue; // Stale
+        int neighbors[4];
+        int count = neighborsOf(top.second, neighbors);
+        for (int i = 0; i < count; ++i) {
+            int neighbor = neighbors[i];
+            int32_t next = top.first + stepCost(neighbor);
+            if (neighbor != target && next < distances[neighbor]) {
+                distances[neighbor] = next;
+                pushEntry(next, neighbor);
+            }
+        }
+    }
+}
+
+// Passes on the improvement of a cell whose distance just dropped
+void FlowField::lowerFrom(int index) {
+    heap.clear();
+    pushEntry(distances[index], index);
+    relax();
+}
+
+// The cost of entering a cell went up. First take the distance from every
+// cell that no longer has a neighbor offering it, in distance order so a
+// cell is only judged after all closer cells were; then give each of them
+// the best distance its neighbors still offer and relax from there.
+void FlowField::raiseFrom(int index) {
+    int neighbors[4];
+    heap.clear();
+    invalidated.assign(1, index);
+    int32_t oldDistance = distances[index];
+    distances[index] = UNREACHABLE;
+    int count = neighborsOf(index, neighbors);
+    for (int i = 0; i < count; ++i) {
+        int neighbor = neighbors[i];
+        if (distances[neighbor] != UNREACHABLE && distances[neighbor] == oldDistance + stepCost(neighbor)) {
+            pushEntry(distances[neighbor], neighbor);
+        }
+    }
+
+    while (!heap.empty()) {
+        Entry top = popEntry();
+        int current = top.second;
+        int32_t d = top.first;
+        if (distances[current] != d || current == target) continue;
+        count = neighborsOf(current, neighbors);
+        bool supported = false;
+        for (int i = 0; i < count && !supported; ++i) {
+            supported = distances[neighbors[i]] != UNREACHABLE && distances[neighbors[i]] + stepCost(current) == d;
+        }
+        if (supported) continue;
+        distances[current] = UNREACHABLE;
+        invalidated.push_back(current);
+        for (int i = 0; i < count; ++i) {
+            int neighbor = neighbors[i];
+            if (distances[neighbor] != UNREACHABLE && distances[neighbor] == d + stepCost(neighbor)) {
+                pushEntry(distances[neighbor], neighbor);
+            }
+        }
+    }
+
+    for (int cell : invalidated) {
+        int32_t best = bestNeighborDistance(cell);
+        if (best != UNREACHABLE) {
+            distances[cell] = best + stepCost(cell);
+            pushEntry(distances[cell], cell);
+        }
+    }
+    relax();
+}
+
+void FlowField::cellChanged(const Match& state, int x, int y) {
+    int index = y * cols + x;
+    bool nowBlocked = isBlockedFor(state, x, y);
+    if (nowBlocked == static_cast<bool>(blocked[index])) {
+        return;
+    }
+    blocked[index] = nowBlocked;
+    if (index == target) {
+        return; // Stays the source either way
+    }
+
+    if (nowBlocked) {
+        if (distances[index] != UNREACHABLE) {
+            raiseFrom(index);
+        }
+        return;
+    }
+
+    // Cheaper: take the best neighbor and pass the improvement on
+    int32_t best = bestNeighborDistance(index);
+    if (best != UNREACHABLE && best + 1 < distances[index]) {
+        distances[index] = best + 1;
+        lowerFrom(index);
+    }
+}
+
+bool FlowField::bestMove(const Match& state, int player, Action& move) const {
+    const PlayerTable& players = state.getPlayers();
+    int32_t best = distance(players.getX(player), players.getY(player));
+    static const int dxs[] = {0, 0, -1, 0, 1}; // Indexed by Direction
+    static const int dys[] = {0, -1, 0, 1, 0};
+
+    Action legal[MAX_PLAYER_ACTIONS];
+    int count = generateLegalActions(state, player, legal);
+    bool found = false;
+    for (int i = 0; i < count; ++i) {
+        if (legal[i].kind != ACTION_MOVE) continue;
+        int x = players.getX(player) + dxs[legal[i].direction] * legal[i].distance;
+        int y = players.getY(player) + dys[legal[i].direction] * legal[i].distance;
+        if (distance(x, y) < best) {
+            best = distance(x, y);
+            move = legal[i];
+            found = true;
+        }
+    }
+    return found;
+}
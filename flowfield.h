@@ -0,0 +1,53 @@
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "engine.h"
+
+// Walking distance from every cell to one target cell, as seen by one team.
+// Entering a cell costs one step, or ENEMY_STEP_COST steps if it holds an
+// opponent (eliminated or not). Match::move() cannot cross such a cell, but
+// counting it as a wall would cut the target off completely whenever
+// defenders stand on every cell around it; with a cost instead, paths go
+// around opponents where they can and up to them where they cannot. The
+// field is built once per match and afterwards only repaired around the
+// cells whose cost changed.
+class FlowField {
+public:
+    // Only seen during a repair: with no walls, every cell has a finite distance
+    static const int32_t UNREACHABLE = INT32_MAX;
+    static const int32_t ENEMY_STEP_COST = 32;
+private:
+    int rows;
+    int cols;
+    char team;
+    int target; // Cell index
+    std::vector<int32_t> distances;
+    std::vector<uint8_t> blocked;
+    typedef std::pair<int32_t, int32_t> Entry; // (distance, cell)
+    std::vector<int32_t> invalidated; // Cells a raise took the distance from
+    std::vector<Entry> heap; // Min-heap of one repair; reused between repairs
+    void pushEntry(int32_t distance, int cell);
+    Entry popEntry();
+    void relax(); // Settles everything reachable from the heap, cheapest first
+    bool isBlockedFor(const Match& state, int x, int y) const;
+    int32_t stepCost(int index) const { return blocked[index] ? ENEMY_STEP_COST : 1; }
+    int neighborsOf(int index, int* out) const; // Up to 4 orthogonal cell indices
+    int32_t bestNeighborDistance(int index) const;
+    void lowerFrom(int index);
+    void raiseFrom(int index);
+public:
+    FlowField() : rows(0), cols(0), team('R'), target(0) {}
+    void build(const Match& state, char team, std::pair<int, int> target);
+    // Call for the source and destination cell of every successful move
+    void cellChanged(const Match& state, int x, int y);
+    int32_t distance(int x, int y) const { return distances[y * cols + x]; }
+    // The legal move of `player` that lands closest to the target, if any
+    // gets strictly closer than where the player stands
+    bool bestMove(const Match& state, int player, Action& move) const;
+};
+
+#endif
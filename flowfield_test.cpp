@@ -0,0 +1,112 @@
+// Regression checks for the flow fields and the greedy policy that uses
+// them; exits non-zero on the first failure
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "flowfield.h"
+#include "greedy.h"
+
+using namespace std;
+
+namespace {
+
+bool fail(const string& message) {
+    cerr << "FAIL: " << message << "\n";
+    return false;
+}
+
+// With more defenders than columns, the enemy stands on every cell next to
+// each flag. Routes must still exist and greedy must still act.
+bool blockedFlagStillRoutes() {
+    for (int playersPerTeam : {13, 14}) {
+        Match state(1);
+        state.setup(12, 12, playersPerTeam);
+        for (char team : {'R', 'B'}) {
+            FlowField field;
+            field.build(state, team, state.getFlag(opponentOf(team)));
+            for (int y = 0; y < state.getRows(); ++y) {
+                for (int x = 0; x < state.getCols(); ++x) {
+                    if (field.distance(x, y) == FlowField::UNREACHABLE) {
+                        return fail("unreachable cell with " + to_string(playersPerTeam) + " players per team");
+                    }
+                }
+            }
+        }
+
+        GreedyPolicy policy;
+        policy.reset(state);
+        int actions = 0;
+        char team = 'R';
+        for (int turn = 0; turn < 200 && state.checkEndConditions().reason == NOT_ENDED; ++turn) {
+            state.resetPlayersMovedFlag();
+            Action action;
+            if (policy.chooseAction(state, team, action)) {
+                if (action.kind == ACTION_MOVE) {
+                    policy.moveMade(state, state.move(action.player, action.direction, action.distance));
+                } else {
+                    state.attack(action.player, action.direction, action.distance);
+                }
+                actions++;
+            }
+            team = opponentOf(team);
+        }
+        if (actions < 100) {
+            return fail("greedy stalled with " + to_string(playersPerTeam) + " players per team: " +
+                        to_string(actions) + " actions in 200 turns");
+        }
+    }
+    return true;
+}
+
+// Repairing after every move must give the same distances as a fresh build
+bool repairMatchesRebuild() {
+    for (unsigned seed = 1; seed <= 100; ++seed) {
+        Match state(seed);
+        state.setup(3 + seed % 12, 3 + seed % 9, 2 + seed % 11);
+        FlowField fields[2];
+        for (char team : {'R', 'B'}) {
+            fields[teamIndex(team)].build(state, team, state.getFlag(opponentOf(team)));
+        }
+        mt19937 random(seed);
+        char team = 'R';
+        vector<Action> actions;
+        for (int turn = 0; turn < 200 && state.checkEndConditions().reason == NOT_ENDED; ++turn) {
+            state.resetPlayersMovedFlag();
+            generateTeamActions(state, team, actions);
+            if (!actions.empty()) {
+                const Action& action = actions[random() % actions.size()];
+                if (action.kind == ACTION_MOVE) {
+                    MoveResult result = state.move(action.player, action.direction, action.distance);
+                    for (FlowField& field : fields) {
+                        field.cellChanged(state, result.fromX, result.fromY);
+                        field.cellChanged(state, result.toX, result.toY);
+                    }
+                } else {
+                    applyAction(state, action);
+                }
+            }
+            for (char fieldTeam : {'R', 'B'}) {
+                FlowField fresh;
+                fresh.build(state, fieldTeam, state.getFlag(opponentOf(fieldTeam)));
+                for (int y = 0; y < state.getRows(); ++y) {
+                    for (int x = 0; x < state.getCols(); ++x) {
+                        if (fresh.distance(x, y) != fields[teamIndex(fieldTeam)].distance(x, y)) {
+                            return fail("repaired field differs from a rebuild, seed " + to_string(seed));
+                        }
+                    }
+                }
+            }
+            team = opponentOf(team);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    bool ok = blockedFlagStillRoutes();
+    ok = repairMatchesRebuild() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#include "greedy.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void GreedyPolicy::reset(const Match& state) {
+    for (char team : {'R', 'B'}) {
+        fields[teamIndex(team)].build(state, team, state.getFlag(opponentOf(team)));
+    }
+}
+
+// Only the two cells a player left and entered can change passability
+void GreedyPolicy::moveMade(const Match& state, const MoveResult& result) {
+    if (!result.ok()) {
+        return;
+    }
+    for (FlowField& field : fields) {
+        field.cellChanged(state, result.fromX, result.fromY);
+        field.cellChanged(state, result.toX, result.toY);
+    }
+}
+
+bool GreedyPolicy::chooseAction(const Match& state, char team, Action& action) {
+    const PlayerTable& players = state.getPlayers();
+    const FlowField& field = fields[teamIndex(team)];
+
+    // Walking distance to the opponent's flag, around opponents, is a lookup
+    order.clear();
+    for (int player = state.teamBegin(team); player < state.teamEnd(team); ++player) {
+        if (!players.isEliminated(player)) {
+            order.push_back(player);
+        }
+    }
+    sort(order.begin(), order.end(), [&](int a, int b) {
+        return field.distance(players.getX(a), players.getY(a)) < field.distance(players.getX(b), players.getY(b));
+    });
+
+    for (int player : order) {
+        // Shoot the first enemy within attack range
+        Action legal[MAX_PLAYER_ACTIONS];
+        int legalCount = generateLegalActions(state, player, legal);
+        for (int dir : {UP, DOWN, LEFT, RIGHT}) {
+            for (int i = 0; i < legalCount; ++i) {
+                if (legal[i].kind == ACTION_ATTACK && legal[i].direction == dir) {
+                    action = legal[i]; // Generated nearest range first
+                    return true;
+                }
+            }
+        }
+
+        // Otherwise step to the neighbor closest to the opponent's flag
+        if (field.bestMove(state, player, action)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+MatchSummary playGreedyMatch(Match& state, GreedyPolicy& policy, int maxTurns) {
+    policy.reset(state);
+    char currentTeam = state.random(-1, RNG_START_TEAM) < 0.5 ? 'R' : 'B';
+
+    MatchSummary summary = {{NOT_ENDED, 0}, 0};
+    int idlePlies = 0;
+    while (summary.turns < maxTurns) {
+        state.resetPlayersMovedFlag();
+        Action action;
+        if (policy.chooseAction(state, currentTeam, action)) {
+            if (action.kind == ACTION_MOVE) {
+                policy.moveMade(state, state.move(action.player, action.direction, action.distance));
+            } else {
+                state.attack(action.player, action.direction, action.distance);
+            }
+            idlePlies = 0;
+        } else if (++idlePlies == 2) {
+            break; // Neither side can act and the policy is deterministic: a draw
+        }
+        summary.outcome = state.checkEndConditions();
+        if (summary.outcome.reason != NOT_ENDED) break;
+        currentTeam = opponentOf(currentTeam);
+        summary.turns++;
+    }
+    return summary;
+}
@@ -0,0 +1,34 @@
+#ifndef GREEDY_H
+#define GREEDY_H
+
+#include <vector>
+
+#include "engine.h"
+#include "flowfield.h"
+
+// The default program opponent: the player closest to the enemy flag shoots
+// if it can, otherwise the first one that can get closer along its team's
+// flow field does so. The fields must be told about every move made.
+class GreedyPolicy {
+private:
+    FlowField fields[2]; // Distance to the enemy flag, per team (teamIndex())
+    std::vector<int> order; // Scratch: active players by distance
+public:
+    void reset(const Match& state); // After Match::setup()
+    void moveMade(const Match& state, const MoveResult& result);
+    bool chooseAction(const Match& state, char team, Action& action);
+    const FlowField& getField(char team) const { return fields[teamIndex(team)]; }
+};
+
+struct MatchSummary {
+    MatchOutcome outcome; // NOT_ENDED for a draw
+    int turns;
+};
+
+// Plays a set-up match greedy against greedy, with the same starting-team
+// draw, turn loop and termination as the headless game (Game::runHeadless()).
+// It is a draw at `maxTurns`, or as soon as both teams in a row cannot act,
+// since nothing can change after that.
+MatchSummary playGreedyMatch(Match& state, GreedyPolicy& policy, int maxTurns);
+
+#endif
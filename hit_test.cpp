@@ -0,0 +1,92 @@
+// Regression checks for the integer hit resolution against the cumulative
+// double comparison it replaced; exits non-zero on the first failure
+#include <iostream>
+#include <vector>
+
+#include "engine.h"
+
+using namespace std;
+
+namespace {
+
+bool fail(const string& message) {
+    cerr << "FAIL: " << message << "\n";
+    return false;
+}
+
+// How Match::attack() rolled before the thresholds: a uniform double in
+// [0, 1) compared against the running sums of the chances
+HitLocation cumulativeRoll(const HitChances& chances, uint32_t draw) {
+    double roll = draw / 4294967296.0;
+    if (roll < chances.head) return HIT_HEAD;
+    if (roll < chances.head + chances.torso) return HIT_TORSO;
+    if (roll < chances.head + chances.torso + chances.extremity) return HIT_EXTREMITY;
+    return HIT_MISS;
+}
+
+// Evenly spread draws, plus every draw next to a bound where rounding the
+// bound to an integer is allowed to move it by one
+void sampleDraws(const HitThresholds& bounds, vector<uint32_t>& draws) {
+    draws.clear();
+    for (uint64_t draw = 0; draw < (1ull << 32); draw += 4093) {
+        draws.push_back(static_cast<uint32_t>(draw));
+    }
+    draws.push_back(0xFFFFFFFFu);
+    for (uint64_t bound : {bounds.head, bounds.torso, bounds.extremity}) {
+        for (uint64_t draw = bound >= 2 ? bound - 2 : 0; draw <= bound + 2 && draw < (1ull << 32); ++draw) {
+            draws.push_back(static_cast<uint32_t>(draw));
+        }
+    }
+}
+
+bool nearBound(const HitThresholds& bounds, uint32_t draw) {
+    for (uint64_t bound : {bounds.head, bounds.torso, bounds.extremity}) {
+        if (draw + 1ull >= bound && draw <= bound + 1ull) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <uint8_t Archetype>
+bool matchesCumulativeRoll() {
+    const Rules rules;
+    const HitChances& chances = rules.hitChancesFor((Archetype & ARCH_EXPERT) != 0);
+    const HitThresholds bounds = hitThresholdsFor(chances);
+    vector<uint32_t> draws;
+    sampleDraws(bounds, draws);
+    vector<HitLocation> batch(draws.size());
+    resolveStandardHits<Archetype>(draws.data(), batch.data(), draws.size());
+
+    long long split[2][4] = {};
+    for (size_t i = 0; i < draws.size(); ++i) {
+        HitLocation before = cumulativeRoll(chances, draws[i]);
+        HitLocation scalar = resolveHit(bounds, draws[i]);
+        if (resolveStandardHit<Archetype>(draws[i]) != scalar || batch[i] != scalar) {
+            return fail("archetype " + to_string(Archetype) + ": resolvers disagree at draw " + to_string(draws[i]));
+        }
+        if (scalar != before && !nearBound(bounds, draws[i])) {
+            return fail("archetype " + to_string(Archetype) + ": draw " + to_string(draws[i]) + " lands at "
+                        + to_string(scalar) + ", the cumulative roll at " + to_string(before));
+        }
+        split[0][before]++;
+        split[1][scalar]++;
+    }
+    // Only the few draws next to a bound may move, and at most by one each
+    for (int location = 0; location < 4; ++location) {
+        if (llabs(split[0][location] - split[1][location]) > 6) {
+            return fail("archetype " + to_string(Archetype) + ": split differs at location " + to_string(location));
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    bool ok = matchesCumulativeRoll<0>();
+    ok = matchesCumulativeRoll<ARCH_FAST>() && ok;
+    ok = matchesCumulativeRoll<ARCH_EXPERT>() && ok;
+    ok = matchesCumulativeRoll<ARCH_FAST | ARCH_EXPERT>() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+#include "input.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// A lone ESC is the Escape key unless the rest of a sequence follows this soon
+const int ESCAPE_TIMEOUT_MS = 30;
+
+bool makePipe(int fds[2]) {
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+// Decodes the key at the start of `bytes`. Returns the bytes it takes, or 0
+// if they may be the start of an escape sequence that has not fully arrived.
+size_t decodeKey(const unsigned char* bytes, size_t count, bool complete, KeyEvent& event) {
+    event.ch = 0;
+    if (bytes[0] == '\n' || bytes[0] == '\r') {
+        event.code = KEY_ENTER;
+        return 1;
+    }
+    if (bytes[0] != '\033') {
+        event.code = KEY_CHAR;
+        event.ch = static_cast<char>(bytes[0]);
+        return 1;
+    }
+    // ESC [ X or ESC O X: cursor keys, in normal and application mode
+    if (count < 3 && !complete && (count == 1 || bytes[1] == '[' || bytes[1] == 'O')) {
+        return 0;
+    }
+    if (count >= 3 && (bytes[1] == '[' || bytes[1] == 'O')) {
+        switch (bytes[2]) {
+            case 'A': event.code = KEY_UP; return 3;
+            case 'B': event.code = KEY_DOWN; return 3;
+            case 'C': event.code = KEY_RIGHT; return 3;
+            case 'D': event.code = KEY_LEFT; return 3;
+        }
+        // Some other control sequence: skip it whole
+        size_t end = 2;
+        while (end < count && !(bytes[end] >= '@' && bytes[end] <= '~')) {
+            end++;
+        }
+        if (end == count && !complete) {
+            return 0;
+        }
+        event.code = KEY_NONE;
+        return end < count ? end + 1 : count;
+    }
+    event.code = KEY_ESCAPE;
+    return 1;
+}
+
+} // namespace
+
+InputReader::InputReader() : ended(false), running(false) {
+    stopPipe[0] = stopPipe[1] = -1;
+    readyPipe[0] = readyPipe[1] = -1;
+}
+
+bool InputReader::start() {
+    if (running) {
+        return true;
+    }
+    if (tcgetattr(STDIN_FILENO, &savedMode) != 0 || !makePipe(stopPipe) || !makePipe(readyPipe)) {
+        ended = true;
+        return false;
+    }
+    termios keyMode = savedMode;
+    keyMode.c_lflag &= ~(ICANON | ECHO);
+    keyMode.c_cc[VMIN] = 1;
+    keyMode.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &keyMode);
+    running = true;
+    reader = thread(&InputReader::run, this);
+    return true;
+}
+
+void InputReader::stop() {
+    if (!running) {
+        return;
+    }
+    char wake = 0;
+    (void)::write(stopPipe[1], &wake, 1);
+    reader.join();
+    tcsetattr(STDIN_FILENO, TCSANOW, &savedMode);
+    for (int fd : {stopPipe[0], stopPipe[1], readyPipe[0], readyPipe[1]}) {
+        close(fd);
+    }
+    stopPipe[0] = stopPipe[1] = readyPipe[0] = readyPipe[1] = -1;
+    running = false;
+}
+
+void InputReader::push(KeyEvent event) {
+    if (event.code == KEY_NONE) {
+        return;
+    }
+    // A full queue means nobody is reading keys; dropping is what a terminal would do
+    if (queue.push(event)) {
+        char ready = 0;
+        (void)::write(readyPipe[1], &ready, 1);
+    }
+}
+
+void InputReader::run() {
+    unsigned char pending[256];
+    size_t count = 0;
+    pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {stopPipe[0], POLLIN, 0}};
+    while (true) {
+        // With half an escape sequence pending, wait only briefly for the rest
+        int timeout = count > 0 ? ESCAPE_TIMEOUT_MS : -1;
+        int ready = ::poll(fds, 2, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        bool complete = ready == 0; // Nothing more came: decode what is there
+        bool atEnd = false;
+        if (fds[0].revents != 0) {
+            ssize_t got = ::read(STDIN_FILENO, pending + count, sizeof(pending) - count);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got > 0) {
+                count += static_cast<size_t>(got);
+                complete = count == sizeof(pending);
+            } else {
+                atEnd = complete = true;
+            }
+        }
+
+        size_t used = 0;
+        while (used < count) {
+            KeyEvent event;
+            size_t taken = decodeKey(pending + used, count - used, complete, event);
+            if (taken == 0) {
+                break;
+            }
+            push(event);
+            used += taken;
+        }
+        count -= used;
+        for (size_t i = 0; i < count; ++i) {
+            pending[i] = pending[used + i];
+        }
+        if (atEnd) {
+            break;
+        }
+    }
+
+    // End of input: whatever waits for a key gets KEY_EOF from now on
+    ended = true;
+    char ready = 0;
+    (void)::write(readyPipe[1], &ready, 1);
+}
+
+bool InputReader::poll(KeyEvent& event) {
+    if (queue.pop(event)) {
+        return true;
+    }
+    if (ended || !running) {
+        // Keys pushed before the end still come first
+        if (queue.pop(event)) {
+            return true;
+        }
+        event.code = KEY_EOF;
+        event.ch = 0;
+        return true;
+    }
+    return false;
+}
+
+bool InputReader::wait(KeyEvent& event, int timeoutMs) {
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(max(timeoutMs, 0));
+    while (!poll(event)) {
+        int remaining = -1;
+        if (timeoutMs >= 0) {
+            auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now());
+            if (left.count() <= 0) {
+                return false;
+            }
+            remaining = static_cast<int>(left.count());
+        }
+        pollfd fd = {readyPipe[0], POLLIN, 0};
+        if (::poll(&fd, 1, remaining) > 0) {
+            char drain[64];
+            while (::read(readyPipe[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <termios.h>
+#include <thread>
+
+// Keyboard input for the interactive game. A reader thread poll()s stdin
+// with the terminal in non-canonical, no-echo mode for the whole match,
+// decodes escape sequences into key events and hands them to the game thread
+// through a lock-free single-producer single-consumer queue. The game thread
+// never blocks in read(): it takes keys when it wants them and can draw or
+// think in between.
+
+enum KeyCode : uint8_t {
+    KEY_NONE = 0,
+    KEY_UP,
+    KEY_DOWN,
+    KEY_LEFT,
+    KEY_RIGHT,
+    KEY_ENTER,
+    KEY_ESCAPE,
+    KEY_CHAR, // Any other byte, in `ch`
+    KEY_EOF // stdin is closed; sticks once seen
+};
+
+struct KeyEvent {
+    KeyCode code;
+    char ch;
+};
+
+// Bounded ring for exactly one pushing and one popping thread. Capacity must
+// be a power of two; push() fails when full instead of overwriting.
+template<typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+private:
+    T items[Capacity];
+    alignas(64) std::atomic<size_t> head{0}; // Next slot to pop; written by the consumer
+    alignas(64) std::atomic<size_t> tail{0}; // Next slot to push; written by the producer
+public:
+    bool push(const T& item) {
+        size_t slot = tail.load(std::memory_order_relaxed);
+        if (slot - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        items[slot & (Capacity - 1)] = item;
+        tail.store(slot + 1, std::memory_order_release);
+        return true;
+    }
+    bool pop(T& item) {
+        size_t slot = head.load(std::memory_order_relaxed);
+        if (slot == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[slot & (Capacity - 1)];
+        head.store(slot + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+class InputReader {
+public:
+    static const size_t QUEUE_CAPACITY = 256;
+private:
+    SpscQueue<KeyEvent, QUEUE_CAPACITY> queue;
+    std::thread reader;
+    std::atomic<bool> ended; // The reader saw end of input
+    int stopPipe[2]; // Written by stop() to wake the reader
+    int readyPipe[2]; // One byte per pushed key, to wake a waiting consumer
+    termios savedMode;
+    bool running;
+    void run();
+    void push(KeyEvent event);
+public:
+    InputReader();
+    ~InputReader() { stop(); }
+    // Switches the terminal to key-at-a-time mode and starts the reader.
+    // Fails if stdin is not usable; keys then read as KEY_EOF.
+    bool start();
+    // Joins the reader and restores the terminal mode
+    void stop();
+    // Next key if one is queued
+    bool poll(KeyEvent& event);
+    // Waits up to `timeoutMs` (forever if negative) for a key
+    bool wait(KeyEvent& event, int timeoutMs);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "journal.h"
+
+using namespace std;
+
+const char* journalNoteText(JournalNote note) {
+    switch (note) {
+        case NOTE_PROGRAM_TURN: return "Program's turn.";
+        case NOTE_NO_ACTIVE_PLAYERS: return "No active players available for program's turn.";
+        case NOTE_NO_ACTION: return "Program couldn't perform any actions.";
+        case NOTE_UNDO: return "Took back the last turn.";
+    }
+    return "";
+}
+
+EventJournal::EventJournal()
+    : events(), total(0), steadyBase(chrono::steady_clock::now()), wallBase(time(nullptr)) {}
+
+JournalEvent& EventJournal::push(const Match& state, char team, JournalSource source, JournalEventKind kind) {
+    JournalEvent& event = events[total++ % CAPACITY];
+    event.time = chrono::steady_clock::now();
+    event.round = state.getPlayers().getRound();
+    event.team = team;
+    event.source = source;
+    event.kind = kind;
+    return event;
+}
+
+void EventJournal::recordMove(const Match& state, char team, JournalSource source, const MoveResult& result) {
+    push(state, team, source, EVENT_MOVE).move = result;
+}
+
+void EventJournal::recordAttack(const Match& state, char team, JournalSource source, const AttackResult& result) {
+    push(state, team, source, EVENT_ATTACK).attack = result;
+}
+
+void EventJournal::recordNote(const Match& state, char team, JournalSource source, JournalNote note) {
+    push(state, team, source, EVENT_NOTE).note = note;
+}
+
+string EventJournal::format(const JournalEvent& event) const {
+    string text;
+    if (event.source == SOURCE_REPLAY) {
+        text = "Round " + to_string(event.round) + ": ";
+    } else {
+        // Wall time of the event, derived from the monotonic stamp
+        time_t when = wallBase + chrono::duration_cast<chrono::seconds>(event.time - steadyBase).count();
+        char buffer[9];
+        strftime(buffer, sizeof(buffer), "%H:%M:%S", localtime(&when));
+        text = string(buffer) + (event.source == SOURCE_USER ? " User: " : " Computer: ");
+    }
+
+    switch (event.kind) {
+        case EVENT_MOVE:
+            return text + describeMove(event.move);
+        case EVENT_ATTACK:
+            return text + describeAttack(event.attack);
+        case EVENT_NOTE:
+            return text + journalNoteText(static_cast<JournalNote>(event.note));
+    }
+    return text;
+}
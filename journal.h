@@ -0,0 +1,58 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include "engine.h"
+
+// The last few things that happened in a match, for the history panel.
+// Events are stored as plain structs in a fixed ring, so recording one never
+// allocates and memory stays flat however long the match runs; text is only
+// built for the handful of events actually displayed.
+
+enum JournalSource : uint8_t { SOURCE_USER = 0, SOURCE_COMPUTER, SOURCE_REPLAY };
+enum JournalEventKind : uint8_t { EVENT_MOVE = 0, EVENT_ATTACK, EVENT_NOTE };
+
+// Fixed messages that are not the result of an action
+enum JournalNote : uint8_t { NOTE_PROGRAM_TURN = 0, NOTE_NO_ACTIVE_PLAYERS, NOTE_NO_ACTION, NOTE_UNDO };
+
+const char* journalNoteText(JournalNote note);
+
+struct JournalEvent {
+    std::chrono::steady_clock::time_point time;
+    uint32_t round; // PlayerTable round of the action
+    char team;
+    uint8_t source; // JournalSource
+    uint8_t kind; // JournalEventKind
+    uint8_t note; // JournalNote, for EVENT_NOTE
+    // Actor, target and outcome, for EVENT_MOVE / EVENT_ATTACK respectively
+    MoveResult move;
+    AttackResult attack;
+};
+
+class EventJournal {
+public:
+    static const int CAPACITY = 32;
+private:
+    JournalEvent events[CAPACITY];
+    uint64_t total; // Events ever recorded; the ring holds the last CAPACITY
+    // Wall-clock reading taken together with a steady one, to print times
+    std::chrono::steady_clock::time_point steadyBase;
+    std::time_t wallBase;
+    JournalEvent& push(const Match& state, char team, JournalSource source, JournalEventKind kind);
+public:
+    EventJournal();
+    void recordMove(const Match& state, char team, JournalSource source, const MoveResult& result);
+    void recordAttack(const Match& state, char team, JournalSource source, const AttackResult& result);
+    void recordNote(const Match& state, char team, JournalSource source, JournalNote note);
+    int size() const { return total < CAPACITY ? static_cast<int>(total) : CAPACITY; }
+    // 0 is the most recent event; `back` must be below size()
+    const JournalEvent& recent(int back) const { return events[(total - 1 - back) % CAPACITY]; }
+    // "HH:MM:SS User: Player 3 moved to (2, 4)." and the like
+    std::string format(const JournalEvent& event) const;
+};
+
+#endif
@@ -2,444 +2,204 @@
 #include <vector>
 #include <string>
 #include <sstream>
-#include <random>
-#include <ctime>
 #include <algorithm>
 #include <map>
 #include <iomanip>
-#include <termios.h>
+#include <memory>
+#include <poll.h>
 #include <unistd.h>
-#include <thread>
 #include <chrono>
 
-#include <SDL.h>
-#include <SDL_mixer.h>
+#include "animation.h"
+#include "audio.h"
+#include "engine.h"
+#include "expectimax.h"
+#include "greedy.h"
+#include "input.h"
+#include "journal.h"
+#include "mcts.h"
+#include "ponder.h"
+#include "render.h"
+#include "replay.h"
+#include "sdl_audio.h"
 
 using namespace std;
 
-// Direction enum for clarity
-enum Direction { UP = 1, LEFT, DOWN, RIGHT };
-
-// Cell class declaration (keep this at the top)
-class Cell {
-private:
-    vector<class Player*> players;
-public:
-    void addPlayer(class Player* player);
-    void removePlayer(class Player* player);
-    const vector<class Player*>& getPlayers() const;
-};
-
-// Player base class
-class Player {
-protected:
-    int id;
-    char team; // 'R' for Red, 'B' for Blue
-    int x, y; // Position on the board
-    int hitsToExtremities;
-    bool eliminated;
-    bool fast; // True if fast, false if slow
-    bool expert; // True if expert, false if novice
-    int maxMovement;
-    int range;
-    double torsoHitChance;
-    double extremityHitChance;
-    double headHitChance;
-    bool shooterEliminated; // True if the shooter is eliminated due to headshot
-    string eliminationReason;
-    int startX, startY; // Add starting position
-    bool moved; // Renamed from hasMoved to moved
-public:
-    Player(int id, char team, bool fast, bool expert);
-    int getId() const;
-    char getTeam() const;
-    int getX() const;
-    int getY() const;
-    void setPosition(int x, int y);
-    bool isEliminated() const;
-    bool isShooterEliminated() const;
-    void setEliminated(bool status, const string& reason = "");
-    std::string move(int direction, int squares, vector<vector<Cell>>& board, mt19937& rng);
-    pair<bool, string> attack(int direction, int squares, vector<vector<Cell>>& board, mt19937& rng);
-    bool isFast() const { return fast; }
-    bool isExpert() const { return expert; }
-    int getMaxMovement() const { return maxMovement; }
-    int getHitsToExtremities() const {
-        return hitsToExtremities;
-    }
-    int getAttackRange() const { return range; }
-    string getEmojiRepresentation() const;
-    string getEliminationReason() const;
-    void setStartPosition(int x, int y);
-    std::pair<int, int> getStartPosition() const;
-    bool hasMoved() const;
-    void resetMoved();
-};
-
-// Cell implementation (moved here, after Player class)
-void Cell::addPlayer(Player* player) {
-    players.push_back(player);
-    // Sort players by ID after adding new player
-    sort(players.begin(), players.end(), 
-         [](Player* a, Player* b) { return a->getId() < b->getId(); });
-}
-
-void Cell::removePlayer(Player* player) {
-    players.erase(remove(players.begin(), players.end(), player), players.end());
-}
-
-const vector<Player*>& Cell::getPlayers() const {
-    return players;
-}
-
-Player::Player(int id, char team, bool fast, bool expert)
-    : id(id), team(team), fast(fast), expert(expert), hitsToExtremities(0),
-      eliminated(false), shooterEliminated(false), moved(false)
-{
-    x = y = -1; // Initial position not set
-    
-    // Set movement capacity based on speed
-    maxMovement = fast ? 2 : 1;
-
-    // Set hit probabilities based on expertise
-    if (expert) {
-        torsoHitChance = 0.6;
-        extremityHitChance = 0.85;
-        headHitChance = 0.05;
-        range = 2; // Expert can attack up to 2 squares
-    } else {
-        torsoHitChance = 0.1;
-        extremityHitChance = 0.5;
-        headHitChance = 0.25;
-        range = 1; // Novice can only attack 1 square
-    }
-}
-
-int Player::getId() const { return id; }
-char Player::getTeam() const { return team; }
-int Player::getX() const { return x; }
-int Player::getY() const { return y; }
-void Player::setPosition(int x, int y) { this->x = x; this->y = y; }
-bool Player::isEliminated() const { return eliminated; }
-bool Player::isShooterEliminated() const { return shooterEliminated; }
-void Player::setEliminated(bool status, const string& reason) {
-    eliminated = status;
-    if (status) {
-        eliminationReason = reason;
-    }
-}
-
-std::string Player::move(int direction, int squares, vector<vector<Cell>>& board, mt19937& rng) {
-    moved = true; // Updated variable name
-    std::stringstream actionStream;
-
-    if (squares == -1) { // Random movement for automatic mode
-        if (fast) {
-            uniform_real_distribution<> dis(0, 1);
-            squares = (dis(rng) <= 0.5) ? 2 : 1; // 50% chance for moving 2 squares
-        } else {
-            squares = 1; // Slow players can only move 1 square
-        }
-    }
-
-    // Validate movement capacity
-    if (squares > maxMovement) {
-        actionStream << "Cannot move " << squares << " squares. Maximum movement is " << maxMovement << ".";
-        return actionStream.str();
-    }
-
-    int dx = 0, dy = 0;
-    switch (direction) {
-        case UP: dy = -1; break;
-        case DOWN: dy = 1; break;
-        case LEFT: dx = -1; break;
-        case RIGHT: dx = 1; break;
-        default: 
-            actionStream << "Invalid direction.";
-            return actionStream.str();
-    }
-
-    for (int i = 1; i <= squares; ++i) {
-        int nx = x + dx * i;
-        int ny = y + dy * i;
-        if (nx < 0 || ny < 0 || ny >= board.size() || nx >= board[0].size()) {
-            actionStream << "Movement would go out of bounds.";
-            return actionStream.str();
-        }
-        Cell& cell = board[ny][nx];
-        const vector<Player*>& playersInCell = cell.getPlayers();
-
-        // Check for opponent players in any cell along the path
-        for (Player* p : playersInCell) {
-            if (p->getTeam() != team) {
-                actionStream << "Cannot move into or through a cell occupied by opponent players.";
-                return actionStream.str();
-            }
-        }
-
-        // Check max 4 players per cell only for the destination cell
-        if (i == squares && playersInCell.size() >= 4) {
-            actionStream << "Destination cell is full (max 4 players per cell).";
-            return actionStream.str();
-        }
-    }
-
-    // Move the player
-    board[y][x].removePlayer(this);
-    x += dx * squares;
-    y += dy * squares;
-
-    // Attempt to add player to the new cell
-    board[y][x].addPlayer(this);
-
-    actionStream << "Player " << id << " moved to (" << x << ", " << y << ").";
-    return actionStream.str();
-}
-
-pair<bool, string> Player::attack(int direction, int squares, vector<vector<Cell>>& board, mt19937& rng) {
-    moved = true; // Updated variable name
-    // 1. Validate direction (orthogonal attacks only)
-    int dx = 0, dy = 0;
-    switch (direction) {
-        case UP: dy = -1; break;
-        case DOWN: dy = 1; break;
-        case LEFT: dx = -1; break;
-        case RIGHT: dx = 1; break;
-        default: 
-            cout << "Invalid attack direction. Must be UP(1), LEFT(2), DOWN(3), or RIGHT(4).\n";
-            return {false, "Invalid attack direction. Must be UP(1), LEFT(2), DOWN(3), or RIGHT(4)."};
-    }
-
-    // 2. Determine and validate attack range
-    int attackRange;
-    if (squares == -1) { // Random range for automatic mode
-        if (expert) {
-            uniform_real_distribution<> dis(0, 1);
-            attackRange = (dis(rng) <= 0.75) ? 1 : 2; // 75% chance for 1 square, 25% for 2
-        } else {
-            attackRange = 1; // Novice can only attack 1 square
-        }
-        squares = attackRange;
-    } else {
-        // Validate manual range input
-        int maxRange = static_cast<bool>(expert) ? 2 : 1; // Explicitly cast 'expert' to bool
-        if (squares > maxRange || squares < 1) {
-            cout << "Invalid attack range. ";
-            cout << (expert ? "Expert players can attack 1-2 squares." : "Novice players can only attack 1 square.");
-            cout << "\n";
-            return {false, std::string("Invalid attack range. ") + (expert ? "Expert players can attack 1-2 squares." : "Novice players can only attack 1 square.")};
-        }
-    }
-
-    // Calculate target position
-    int targetX = x + (dx * squares);
-    int targetY = y + (dy * squares);
-    
-    // Check if target is in bounds
-    if (targetX < 0 || targetY < 0 || targetY >= board.size() || targetX >= board[0].size()) {
-        cout << "Attack target is out of bounds.\n";
-        return {false, "Attack target is out of bounds."};
-    }
-
-    // 3. Check line of sight (no obstacles between attacker and target)
-    for (int i = 1; i <= squares; i++) {
-        int checkX = x + (dx * i);
-        int checkY = y + (dy * i);
-        Cell& checkCell = board[checkY][checkX];
-        
-        // If we find any players before the target square, attack is blocked
-        if (i < squares && !checkCell.getPlayers().empty()) {
-            cout << "Line of sight blocked by players in intermediate squares.\n";
-            return {false, "Line of sight blocked by players in intermediate squares."};
-        }
-        
-        // When we reach target square, check for valid targets
-        if (i == squares) {
-            const vector<Player*>& playersInCell = checkCell.getPlayers();
-            
-            // Check if there are any valid targets (non-eliminated enemies)
-            bool hasValidTarget = false;
-            for (Player* target : playersInCell) {
-                if (target->getTeam() != team && !target->isEliminated()) {
-                    hasValidTarget = true;
-                    break;
-                }
-            }
-
-            if (!hasValidTarget) {
-                cout << "No valid targets in range.\n";
-                return {false, "No valid targets in range."};
-            }
-
-            // 4. Select first valid target and perform attack
-            for (Player* target : playersInCell) {
-                if (target->getTeam() != team && !target->isEliminated()) {
-                    uniform_real_distribution<> dis(0, 1);
-                    double hitRoll = dis(rng);
-
-                    if (hitRoll < headHitChance) {
-                        eliminated = true;
-                        shooterEliminated = true;
-                        eliminationReason = "Headshot penalty";
-                        return {true, "Player " + to_string(id) + " hit opponent's head and is eliminated due to rule violation!"};
-                    } else if (hitRoll < headHitChance + torsoHitChance) {
-                        target->setEliminated(true, "Hit in torso");
-                        return {true, "Player " + to_string(id) + " hit opponent player " + to_string(target->getId())
-                                     + "'s torso! Player " + to_string(target->getId()) + " is eliminated!"};
-                    } else if (hitRoll < headHitChance + torsoHitChance + extremityHitChance) {
-                        target->hitsToExtremities++;
-                        string result = "Player " + to_string(id) + " hit opponent player " + to_string(target->getId())
-                                        + "'s extremity! (" + to_string(target->hitsToExtremities) + "/3 hits)";
-                        if (target->hitsToExtremities >= 3) {
-                            target->setEliminated(true, "3 extremity hits");
-                            result += " Player " + to_string(target->getId()) + " received 3 hits to extremities and is eliminated!";
-                        }
-                        return {true, result};
-                    }
-
-                    // Miss
-                    return {false, "Player " + to_string(id) + " missed the shot."};
-                }
-            }
-        }
-    }
-
-    return {false, "No valid targets in range."};
-}
-
-string Player::getEmojiRepresentation() const {
-    string expertEmoji = expert ? "🎯" : "🔰";
-    string speedEmoji = fast ? "🏃" : "🐢";
-    string hits = "(" + to_string(hitsToExtremities) + ")";
-    string idStr = to_string(id);
-    return expertEmoji + speedEmoji + hits + "[" + idStr + "]";
-}
-
-string Player::getEliminationReason() const {
-    return eliminationReason;
-}
-
-void Player::setStartPosition(int x, int y) {
-    startX = x;
-    startY = y;
-}
-
-std::pair<int, int> Player::getStartPosition() const {
-    return {startX, startY};
-}
-
-bool Player::hasMoved() const {
-    return moved;
-}
-
-void Player::resetMoved() {
-    moved = false;
-}
+// Board cells on screen, in terminal columns and lines; the last line holds
+// the coordinates
+const int CELL_WIDTH = 20;
+const int CELL_HEIGHT = 6;
+
+// Terminal lines below the board: panels, selection keys and the prompt,
+// then the program's messages of its last turn
+const int PANEL_LINES = 18;
+const int MESSAGE_LINES = 3;
+// Largest minimap, in characters
+const int MINIMAP_MAX_COLS = 64;
+const int MINIMAP_MAX_ROWS = 12;
+// Latest eliminations listed per team in the stats panel
+const int STATS_RECENT_ELIMINATIONS = 8;
+// Effect timing, in 60 Hz ticks: about 100 ms per cell a shot crosses and
+// 30 ms per character of a program message, which then stays up 4 seconds
+const int SHOT_TICKS_PER_CELL = 6;
+const int MESSAGE_TICKS_PER_CHAR = 2;
+const int MESSAGE_HOLD_TICKS = 4 * AnimationScheduler::TICKS_PER_SECOND;
+const int MESSAGE_GROUP = 1; // Scheduler group of the program's messages
+
+// Who decides the program's moves
+enum AiKind { AI_GREEDY = 0, AI_MCTS, AI_EXPECTIMAX };
 
 // Game class
 class Game {
 private:
-    int boardSize;
-    int numPlayersPerTeam;
-    vector<vector<Cell>> board;
-    vector<Player*> redTeam;
-    vector<Player*> blueTeam;
-    mt19937 rng;
+    Match match; // Board, teams and rules; everything else here is presentation
     char userTeam;
     int turns;
     bool gameEnded;
     string winner;
-    pair<int, int> redFlag;
-    pair<int, int> blueFlag;
-    map<int, Player*> playerMap; // Map player IDs to player objects
-    vector<pair<char, string>> actionHistory;
-    Mix_Music* bgm;
-    Mix_Chunk* jumpSound;
-    Mix_Chunk* gameoverSound;
-    std::thread escapeThread;
-    bool redTeamMoved;
-    bool blueTeamMoved;
-    int playerIDCounter;
+    EventJournal journal; // Recent actions for the history panel
+    unique_ptr<AudioBackend> audio; // NullAudio until play() opens the device
+    bool soundEnabled;
+    bool splashEnabled;
+    // Startup timing, reported on exit
+    chrono::steady_clock::time_point createdAt;
+    chrono::steady_clock::time_point setupDoneAt; // The last setup answer
+    double firstPromptMs; // After construction; -1 until shown
+    double firstBoardMs; // After the last setup answer; -1 until shown
+    bool headless; // No terminal, audio or sleeps; used for automated runs
+    AiKind aiKinds[2]; // Per team, indexed by teamIndex()
+    MctsSearch mcts;
+    ExpectimaxSearch expectimax;
+    GreedyPolicy greedy;
+    Ponderer ponderer; // Searches the program's replies while the user thinks
+    bool ponderEnabled;
+    long long searchRollouts; // Totals over every MCTS decision of the match
+    double searchMs;
+    long long searchNodes; // Totals over every expectiminimax decision
+    double expectimaxMs;
+    ReplayWriter recorder; // Only writes once recordTo() succeeded
+    vector<UndoEntry> undo; // Every change of an interactive match, for the undo key
+    vector<size_t> turnStarts; // Undo stack size when each user turn began
+    TerminalRenderer screen; // Board screen, redrawn in place
+    InputReader input; // Keys, read on their own thread while the match is played
+    AnimationScheduler effects; // Shots and program messages, over the board screen
+    int viewX; // Top-left cell of the part of the board on screen
+    int viewY;
+    vector<int> minimapCounts; // Active players per minimap block and team
+    // What minimapCounts was counted for; block size 0 until the first count
+    uint64_t minimapHash = 0;
+    int minimapBlockCols = 0;
+    int minimapBlockRows = 0;
+    // A player's token, ready to copy into a cell line, for the hit count it
+    // was built for
+    struct PlayerGlyph {
+        int hits = -1; // -1 until first built
+        string cellLine[2]; // Centred and coloured; plain and highlighted
+        string label; // Coloured token alone, for the selection panel
+    };
+    vector<PlayerGlyph> glyphs; // By player ID
+    // Bottom line of each cell in the viewport, by slot, built on first use.
+    // Cleared when the view scrolls or resizes, so it never grows with the board.
+    vector<string> coordLines;
+    int coordViewX = -1;
+    int coordViewY = -1;
+    int coordViewCols = 0;
+    int coordViewRows = 0;
+    string blankLine; // Cell line without a player
+    const PlayerGlyph& glyphFor(int player);
+    void setCoordinateView(int viewCols, int viewRows);
+    const string& coordinateLine(int x, int y);
+    void performProgramAction(char programTeamId, const Action& action);
+    MoveResult playMove(int player, int direction, int squares);
+    AttackResult playAttack(int player, int direction, int squares);
+    bool undoLastTurn();
+    void startPondering();
+    KeyEvent nextKey();
+    int readDirection();
+    int readOneOrTwo();
+    void composeBoard(int cursorX, int cursorY, int playerIndex, bool hints);
+    void composeMinimap(int mapCols, int mapRows, int viewCols, int viewRows);
+    void presentFrame();
+    void animateShot(int shooter, int direction, int squares, const AttackResult& result);
+    void waitForAudio();
 public:
     Game();
+    Game(uint64_t seed, bool headless);
     void initialize();
-    void displayBoard();
     void play();
     void userTurn();
-    void programTurn();
+    bool programTurn(char programTeamId); // False if it found no action
     bool checkEndConditions();
-    ~Game();
+    void endGame(const string& winningTeam, const string& message, bool showBoard);
+    void logProgramAction(char team, JournalNote note);
+    void logProgramAction(char team, const MoveResult& result);
+    void logProgramAction(char team, const AttackResult& result);
+    void printProgramAction(const string& message);
+    void runHeadless(int numRows, int numCols, int playersPerTeam, int maxTurns);
+    void setAi(char team, AiKind kind) { aiKinds[teamIndex(team)] = kind; }
+    void setMctsConfig(const MctsConfig& config) { mcts = MctsSearch(config); }
+    void setExpectimaxConfig(const ExpectimaxConfig& config) { expectimax = ExpectimaxSearch(config); }
+    void setPondering(bool enabled) { ponderEnabled = enabled; }
+    void setSplash(bool enabled) { splashEnabled = enabled; }
+    void setSound(bool enabled) { soundEnabled = enabled; }
+    void setEffects(bool enabled) { effects.setEnabled(enabled); }
+    bool recordTo(const string& path) { return recorder.open(path); }
+    bool runReplay(ReplayReader& reader, bool render, uint32_t fromRound);
     void displayBoardWithCursor(int cursorX, int cursorY, int playerIndex);
+    void refreshBoard(int cursorX, int cursorY, int playerIndex, bool hints);
     void displaySplashScreen();
     void displayGameOverScreen();
-    void animateText(const string& text);
-    void displayAttackAnimation(int fromX, int fromY, int toX, int toY);
-    void playMusic(const std::string& musicFilePath);
-    void stopMusic();
     int getVisibleLength(const string& s) const;
     int getDisplayWidth(const string& s) const;
-    void resetPlayersMovedFlag();
+    string getEmojiRepresentation(int player) const;
 };
 
-Game::Game() : redTeamMoved(false), blueTeamMoved(false), playerIDCounter(0) {
-    rng.seed(static_cast<unsigned int>(time(0)));
+Game::Game() : Game(freshSeed(), false) {}
+
+Game::Game(uint64_t seed, bool headless)
+    : match(seed), audio(new NullAudio()), headless(headless), viewX(0), viewY(0),
+      blankLine(CELL_WIDTH, ' ') {
+    aiKinds[0] = aiKinds[1] = AI_GREEDY;
+    ponderEnabled = true;
+    soundEnabled = !headless; // Headless matches never touch the audio device
+    effects.setEnabled(!headless);
+    splashEnabled = true;
+    createdAt = chrono::steady_clock::now();
+    setupDoneAt = createdAt;
+    firstPromptMs = -1;
+    firstBoardMs = -1;
+    searchRollouts = 0;
+    searchMs = 0;
+    searchNodes = 0;
+    expectimaxMs = 0;
     turns = 0;
     gameEnded = false;
 
     // Randomly choose starting team
-    uniform_int_distribution<> startTeamDis(0, 1);
-    userTeam = startTeamDis(rng) == 0 ? 'R' : 'B';
-
-    // Randomly assign flag colors
-    uniform_int_distribution<> flagColorDis(0, 1);
-    if (flagColorDis(rng) == 0) {
-        redFlag = make_pair(0, 0);
-        blueFlag = make_pair(boardSize - 1, boardSize - 1);
-    } else {
-        redFlag = make_pair(boardSize - 1, boardSize - 1);
-        blueFlag = make_pair(0, 0);
-    }
-
-    // Initialize SDL2
-    if (SDL_Init(SDL_INIT_AUDIO) < 0) {
-        std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
-        return;
-    }
-
-    // Initialize SDL_mixer
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
-        std::cerr << "SDL_mixer could not initialize! SDL_mixer Error: " << Mix_GetError() << std::endl;
-        SDL_Quit();
-        return;
-    }
-
-    // Load background music
-    bgm = Mix_LoadMUS("music/juego.mp3");
-    if (!bgm) {
-        std::cerr << "Failed to load background music! SDL_mixer Error: " << Mix_GetError() << std::endl;
-    }
-
-    // **Load sound effects**
-    jumpSound = Mix_LoadWAV("music/jump.mp3");
-    if (!jumpSound) {
-        std::cerr << "Failed to load jump sound effect! SDL_mixer Error: " << Mix_GetError() << std::endl;
-    }
+    userTeam = match.random(-1, RNG_USER_TEAM) < 0.5 ? 'R' : 'B';
+}
 
-    gameoverSound = Mix_LoadWAV("music/gameover.mp3");
-    if (!gameoverSound) {
-        std::cerr << "Failed to load game over sound effect! SDL_mixer Error: " << Mix_GetError() << std::endl;
+// Prints what failed to load, once
+void Game::waitForAudio() {
+    string errors;
+    if (!audio->waitUntilReady(errors)) {
+        cerr << errors;
     }
 }
 
  // Start of Selection
 void Game::initialize() {
-    int numRows, numCols;
+    int numRows, numCols, numPlayersPerTeam;
     string input;
 
     cout << "Enter number of rows for the board: ";
+    if (firstPromptMs < 0) {
+        cout << flush;
+        firstPromptMs = chrono::duration<double, milli>(chrono::steady_clock::now() - createdAt).count();
+    }
     getline(cin, input);
     numRows = stoi(input);
-    while (numRows <= 0) {
+    while (numRows <= 0 || numRows > MAX_BOARD_SIDE) {
         cout << "Invalid number of rows. Enter again: ";
         getline(cin, input);
         numRows = stoi(input);
@@ -448,103 +208,26 @@ void Game::initialize() {
     cout << "Enter number of columns for the board: ";
     getline(cin, input);
     numCols = stoi(input);
-    while (numCols <= 0) {
+    while (numCols <= 0 || numCols > MAX_BOARD_SIDE) {
         cout << "Invalid number of columns. Enter again: ";
         getline(cin, input);
         numCols = stoi(input);
     }
 
-    // Initialize board with specified rows and columns
-    board.resize(numRows, vector<Cell>(numCols));
-
-    // Set boardSize based on the input dimensions
-    boardSize = numRows * numCols;
-
-    // Randomly assign flag positions
-    uniform_int_distribution<> flagColorDis(0, 1);
-    if (flagColorDis(rng) == 0) {
-        redFlag = make_pair(0, 0);
-        blueFlag = make_pair(numCols - 1, numRows - 1);
-    } else {
-        redFlag = make_pair(numCols - 1, numRows - 1);
-        blueFlag = make_pair(0, 0);
-    }
-
     // Ask user for the number of players per team
     cout << "Enter number of players per team: ";
     getline(cin, input);
     numPlayersPerTeam = stoi(input);
-    while (numPlayersPerTeam <= 0) {
+    while (numPlayersPerTeam <= 0 || numPlayersPerTeam > MAX_PLAYERS_PER_TEAM) {
         cout << "Invalid number of players. Enter again: ";
         getline(cin, input);
         numPlayersPerTeam = stoi(input);
     }
 
-    // Initialize players for each team
-    uniform_real_distribution<> playerTypeDis(0, 1);
-
-    // Function to place players starting from a base cell
-    auto placePlayers = [&](vector<Player*>& teamPlayers, char team, int startX, int startY) {
-        int x = startX;
-        int y = startY;
-        int playersAdded = 0;
-
-        while (playersAdded < numPlayersPerTeam) {
-            Cell& cell = board[y][x];
-
-            // Only add one player per cell during initialization
-            if (playersAdded < numPlayersPerTeam) {
-                // Determine player type based on probabilities
-                double randomValue = playerTypeDis(rng);
-                bool fast = false, expert = false;
-
-                if (randomValue < 0.15) {
-                    fast = true; expert = true; // Fast Expert (ER)
-                } else if (randomValue < 0.40) {
-                    fast = false; expert = true; // Slow Expert (EL)
-                } else if (randomValue < 0.90) {
-                    fast = true; expert = false; // Fast Novice (NR)
-                } else {
-                    fast = false; expert = false; // Slow Rookie (NL)
-                }
-
-                Player* player = new Player(playerIDCounter, team, fast, expert);
-                player->setPosition(x, y);
-                player->setStartPosition(x, y); // Set the starting position
-                teamPlayers.push_back(player);
-                playerMap[player->getId()] = player;
-                cell.addPlayer(player);
-
-                playerIDCounter++; // Increment the playerIDCounter
-                playersAdded++;
-            }
-
-            // Move to the next cell in the row or column
-            if (startX == 0) x++;
-            else x--;
-
-            if (x < 0 || x >= numCols) {
-                x = startX;
-                if (startY == 0) y++;
-                else y--;
-                if (y < 0 || y >= numRows) break;
-            }
-        }
-    };
-
-    // Place Red Team players starting from redFlag position
-    placePlayers(redTeam, 'R', redFlag.first, redFlag.second);
-
-    // Place Blue Team players starting from blueFlag position
-    placePlayers(blueTeam, 'B', blueFlag.first, blueFlag.second);
-}
-
-string getCurrentTime() {
-    time_t now = time(0);
-    tm* localtm = localtime(&now);
-    char buffer[9];
-    strftime(buffer, sizeof(buffer), "%H:%M:%S", localtm);
-    return string(buffer);
+    setupDoneAt = chrono::steady_clock::now();
+    match.setup(numRows, numCols, numPlayersPerTeam);
+    greedy.reset(match);
+    recorder.writeHeader(match);
 }
 
 void Game::play() {
@@ -553,46 +236,76 @@ void Game::play() {
     const string BLUE = "\033[34m";
     const string RESET = "\033[0m";
 
+    // Opening the device and decoding the MP3s takes longer than drawing
+    // anything: it happens while the splash and the setup prompts are up
+    if (soundEnabled) {
+        audio.reset(new SdlAudio());
+    }
     displaySplashScreen(); // Display splash screen
 
     initialize();
+    input.start(); // Setup answers above are whole lines; from here on it is keys
 
-    // Start playing music after initialization
-    playMusic("music/juego.mp3");
+    // Start playing music after initialization; loading has usually
+    // finished by the time the setup questions are answered
+    waitForAudio();
+    audio->playMusic();
 
     // Randomly decide which team starts
-    uniform_int_distribution<> startTeamDis(0, 1);
-    char currentTeam = startTeamDis(rng) == 0 ? userTeam : (userTeam == 'R' ? 'B' : 'R');
+    char currentTeam = match.random(-1, RNG_START_TEAM) < 0.5 ? userTeam : (userTeam == 'R' ? 'B' : 'R');
 
     // Display user's team with color
     cout << "You are on the " << (userTeam == 'R' ? RED + "Red Team" + RESET : BLUE + "Blue Team" + RESET) << ".\n";
     cout << ((currentTeam == userTeam) ? "You start first!\n" : "Program starts first.\n");
+    cout << "Match seed: " << match.getSeed() << " (replay it with --seed " << match.getSeed() << ")\n";
 
     while (!gameEnded) {
         // Reset moved flags at the start of each round
-        resetPlayersMovedFlag();
+        match.makeNewRound(undo);
 
         displayBoardWithCursor(-1, -1, -1); // Display the board
+        if (firstBoardMs < 0) {
+            firstBoardMs = chrono::duration<double, milli>(chrono::steady_clock::now() - setupDoneAt).count();
+        }
 
         if (currentTeam == userTeam) {
+            turnStarts.push_back(undo.size());
+            startPondering();
             userTurn();
+            ponderer.stop();
             if (gameEnded || checkEndConditions()) break;
             currentTeam = (userTeam == 'R' ? 'B' : 'R'); // Switch to program's team
         } else {
-            programTurn();
+            programTurn(userTeam == 'R' ? 'B' : 'R');
             if (gameEnded || checkEndConditions()) break;
             currentTeam = userTeam; // Switch back to user's team
         }
 
         turns++;
     }
+    input.stop();
+    ponderer.stop();
     cout << "Game over! Winner: " << winner << ". Total turns: " << turns << "\n";
+    const PonderStats& ponder = ponderer.getStats();
+    if (ponder.hits + ponder.misses > 0) {
+        cout << "Pondering: " << ponder.hits << " of " << ponder.hits + ponder.misses
+             << " replies were ready when your turn ended (" << ponder.positions << " positions searched).\n";
+    }
+    cout << fixed << setprecision(1) << "Startup: first prompt after " << firstPromptMs
+         << " ms, first board " << firstBoardMs << " ms after the last setup answer";
+    if (audio->getLoadMs() >= 0) {
+        cout << ", audio loaded in " << audio->getLoadMs() << " ms";
+    }
+    cout << ".\n" << defaultfloat;
+    if (audio->getCoalescedEffects() > 0) {
+        cout << "Sound: " << audio->getCoalescedEffects() << " effects merged into ones already playing.\n";
+    }
 
     displayGameOverScreen(); // Display Game Over screen
 
     if (gameEnded) {
         // **Play game over sound effect**
-        Mix_PlayChannel(-1, gameoverSound, 0);
+        audio->playEffect(SOUND_GAME_OVER);
     }
 }
 
@@ -601,12 +314,12 @@ void Game::play() {
 void Game::userTurn() {
     bool validTurn = false;
 
-    while (!validTurn) {
+    while (!validTurn && !gameEnded) {
 
-        vector<Player*>& teamPlayers = (userTeam == 'R' ? redTeam : blueTeam);
-        vector<Player*> activePlayers;
-        for (Player* p : teamPlayers) {
-            if (!p->isEliminated()) {
+        const PlayerTable& players = match.getPlayers();
+        vector<int> activePlayers;
+        for (int p = match.teamBegin(userTeam); p < match.teamEnd(userTeam); ++p) {
+            if (!players.isEliminated(p)) {
                 activePlayers.push_back(p);
             }
         }
@@ -619,27 +332,28 @@ void Game::userTurn() {
 
         // Collect cells that have active players of the user's team
         vector<pair<int, int>> teamCells;
-        map<pair<int, int>, vector<Player*>> cellPlayersMap;
-        for (Player* p : activePlayers) {
-            pair<int, int> pos = make_pair(p->getX(), p->getY());
-            if (cellPlayersMap.find(pos) == cellPlayersMap.end()) {
-                teamCells.push_back(pos);
+        map<pair<int, int>, vector<int>> cellPlayersMap;
+        for (int p : activePlayers) {
+            pair<int, int> pos = make_pair(players.getX(p), players.getY(p));
+            if (cellPlayersMap.find(pos) != cellPlayersMap.end()) {
+                continue;
+            }
+            teamCells.push_back(pos);
+
+            // Keep the cell's own (arrival) order so it matches the highlighted row
+            const Cell& cell = match.getBoard().at(pos.first, pos.second);
+            for (int k = 0; k < cell.size(); ++k) {
+                int occupant = cell[k];
+                if (players.getTeam(occupant) == userTeam && !players.isEliminated(occupant)) {
+                    cellPlayersMap[pos].push_back(occupant);
+                }
             }
-            cellPlayersMap[pos].push_back(p);
         }
 
         int cellIndex = -1;    // Index for navigating between cells (no cell selected initially)
         int playerIndex = -1;  // Index for navigating between players in a cell (no player selected initially)
 
-        struct termios oldt, newt;
-        tcgetattr(STDIN_FILENO, &oldt);
-        newt = oldt;
-        newt.c_lflag &= ~(ICANON | ECHO);
-        tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-
         while (true) {
-            system("clear");
-
             // If a cell is selected, get its coordinates
             int cursorX = -1;
             int cursorY = -1;
@@ -648,647 +362,710 @@ void Game::userTurn() {
                 cursorY = teamCells[cellIndex].second;
             }
 
-            displayBoardWithCursor(cursorX, cursorY, playerIndex);
-
-            cout << "Use arrow keys to move (UP/DOWN between cells, LEFT/RIGHT between players in cell). Press Enter to select a player.\n";
+            refreshBoard(cursorX, cursorY, playerIndex, true);
 
-            int c = cin.get();
-            if (c == '\033') { // Start of escape sequence
-                cin.get();     // Skip the [
-                switch (cin.get()) {
-                    case 'A': // Arrow up
-                        if (cellIndex > 0) {
-                            cellIndex--;
-                            playerIndex = 0; // Reset player index when changing cells
-                        }
-                        break;
-                    case 'B': // Arrow down
-                        if (cellIndex < (int)teamCells.size() - 1) {
-                            cellIndex++;
-                            playerIndex = 0; // Reset player index when changing cells
-                        }
-                        break;
-                    case 'C': // Arrow right
-                        if (cellIndex != -1) {
-                            pair<int, int> pos = teamCells[cellIndex];
-                            vector<Player*>& playersInCell = cellPlayersMap[pos];
-                            if (playerIndex < (int)playersInCell.size() - 1) {
-                                playerIndex++;
-                            }
-                        }
-                        break;
-                    case 'D': // Arrow left
-                        if (cellIndex != -1) {
-                            if (playerIndex > 0) {
-                                playerIndex--;
-                            }
-                        }
-                        break;
+            KeyEvent key = nextKey();
+            if (key.code == KEY_UP) {
+                if (cellIndex > 0) {
+                    cellIndex--;
+                    playerIndex = 0; // Reset player index when changing cells
+                }
+            } else if (key.code == KEY_DOWN) {
+                if (cellIndex < (int)teamCells.size() - 1) {
+                    cellIndex++;
+                    playerIndex = 0; // Reset player index when changing cells
+                }
+            } else if (key.code == KEY_RIGHT) {
+                if (cellIndex != -1) {
+                    pair<int, int> pos = teamCells[cellIndex];
+                    vector<int>& playersInCell = cellPlayersMap[pos];
+                    if (playerIndex < (int)playersInCell.size() - 1) {
+                        playerIndex++;
+                    }
+                }
+            } else if (key.code == KEY_LEFT) {
+                if (cellIndex != -1) {
+                    if (playerIndex > 0) {
+                        playerIndex--;
+                    }
+                }
+            } else if (key.code == KEY_CHAR && (key.ch == 'u' || key.ch == 'U')) {
+                if (undoLastTurn()) {
+                    break; // Choose again on the restored board
                 }
-            } else if ((c == '\n' || c == '\r') && cellIndex != -1 && playerIndex != -1) { // Enter key
+            } else if (key.code == KEY_ENTER && cellIndex != -1 && playerIndex != -1) {
                 pair<int, int> pos = teamCells[cellIndex];
-                vector<Player*>& playersInCell = cellPlayersMap[pos];
-                Player* selectedPlayer = playersInCell[playerIndex];
-
-                if (selectedPlayer && !selectedPlayer->isEliminated()) {
-                    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-                    cout << "Selected Player " << selectedPlayer->getId() << " at (" << selectedPlayer->getX() << ", " << selectedPlayer->getY() << ")\n";
-                    char action;
-                    cout << "Enter 'm' to move or 'a' to attack: ";
-                    cin >> action;
-                    cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-                    if (action == 'm') {
+                vector<int>& playersInCell = cellPlayersMap[pos];
+                int selectedPlayer = playersInCell[playerIndex];
+
+                if (!players.isEliminated(selectedPlayer)) {
+                    screen.invalidate(); // Prompts follow the frame
+                    cout << "Selected Player " << selectedPlayer << " at (" << players.getX(selectedPlayer) << ", " << players.getY(selectedPlayer) << ")\n";
+                    cout << "Enter 'm' to move or 'a' to attack: " << flush;
+                    KeyEvent action = nextKey();
+                    cout << "\n";
+
+                    if (action.code == KEY_CHAR && action.ch == 'm') {
                         // Movement
                         cout << "Use arrow keys to select direction to move. Press 'Esc' to cancel.\n";
-                        int direction = -1;
-                        while (direction == -1) {
-                            int c = cin.get();
-                            if (c == '\033') { // Start of escape sequence
-                                cin.get();     // Skip the [
-                                switch (cin.get()) {
-                                    case 'A': direction = UP; break;
-                                    case 'B': direction = DOWN; break;
-                                    case 'C': direction = RIGHT; break;
-                                    case 'D': direction = LEFT; break;
-                                }
-                            }
-                        }
+                        int direction = readDirection();
                         if (direction == -1) continue; // If action was canceled
 
-                        int squares = selectedPlayer->getMaxMovement();
+                        int squares = players.getMaxMovement(selectedPlayer);
 
                         // Prompt the user if the player can move more than one square
                         if (squares > 1) {
-                            cout << "Enter number of squares to move (1 or 2): ";
-                            while (true) {
-                                string input;
-                                getline(cin, input);
-                                try {
-                                    int inputSquares = stoi(input);
-                                    if (inputSquares == 1 || inputSquares == 2) {
-                                        squares = inputSquares;
-                                        break;
-                                    }
-                                } catch (const invalid_argument& e) {
-                                    cout << "Invalid input. Please enter 1 or 2: ";
-                                } catch (const out_of_range& e) {
-                                    cout << "Invalid input. Please enter 1 or 2: ";
-                                }
-                            }
+                            cout << "Enter number of squares to move (1 or 2): " << flush;
+                            squares = readOneOrTwo();
+                            if (squares == -1) continue;
                         } else {
                             squares = 1;
                             cout << "This player can only move 1 square.\n";
                         }
 
-                        std::string moveResult = selectedPlayer->move(direction, squares, board, rng);
+                        MoveResult result = playMove(selectedPlayer, direction, squares);
+                        std::string moveResult = describeMove(result);
                         cout << moveResult << "\n";
-                        actionHistory.push_back(make_pair(userTeam, getCurrentTime() + " User: " + moveResult));
+                        journal.recordMove(match, userTeam, SOURCE_USER, result);
                         validTurn = true;
-
-                        // juego.cpp: In userTurn() after a successful move
-                        if (selectedPlayer->getTeam() == 'R') {
-                            redTeamMoved = true;
-                        } else {
-                            blueTeamMoved = true;
-                        }
-
-                    } else if (action == 'a') {
+                    } else if (action.code == KEY_CHAR && action.ch == 'a') {
                         // Attack
                         cout << "Use arrow keys to select attack direction. Press 'Esc' to cancel.\n";
-                        int direction = -1;
-                        while (direction == -1) {
-                            int c = cin.get();
-                            if (c == '\033') { // Start of escape sequence
-                                cin.get();     // Skip the [
-                                switch (cin.get()) {
-                                    case 'A': direction = UP; break;
-                                    case 'B': direction = DOWN; break;
-                                    case 'C': direction = RIGHT; break;
-                                    case 'D': direction = LEFT; break;
-                                }
-                            }
-                        }
+                        int direction = readDirection();
                         if (direction == -1) continue; // If action was canceled
 
                         int range = -1;
-                        if (selectedPlayer->isExpert()) {
-                            cout << "Enter attack range (1 or 2): ";
-                            // Immediate input without pressing Enter
-                            while (range == -1) {
-                                int c = cin.get();
-                                if (c == '1') range = 1;
-                                else if (c == '2') range = 2;
-                                else cout << "\nInvalid range. Enter 1 or 2: ";
-                            }
+                        if (players.isExpert(selectedPlayer)) {
+                            cout << "Enter attack range (1 or 2): " << flush;
+                            range = readOneOrTwo();
+                            if (range == -1) continue;
                         } else {
                             range = 1; // Novice attacks at range 1
                             cout << "This is a novice player. Attack range is 1.\n";
                         }
 
-                        pair<bool, string> attackResult = selectedPlayer->attack(direction, range, board, rng);
-                        cout << attackResult.second << "\n";
-                        actionHistory.push_back(make_pair(userTeam, getCurrentTime() + " User: " + attackResult.second));
+                        AttackResult shot = playAttack(selectedPlayer, direction, range);
+                        std::string attackResult = describeAttack(shot);
+                        cout << attackResult << "\n";
+                        journal.recordAttack(match, userTeam, SOURCE_USER, shot);
                         validTurn = true;
-                    } else {
+                    } else if (action.code != KEY_EOF) {
                         cout << "Invalid action. Press Enter to try again.\n";
-                        cin.get();
+                        while (true) {
+                            KeyEvent next = nextKey();
+                            if (next.code == KEY_ENTER || next.code == KEY_EOF) break;
+                        }
                     }
 
                     if (validTurn) {
                         // Play jump sound effect
-                        Mix_PlayChannel(-1, jumpSound, 0);
-                        tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+                        audio->playEffect(SOUND_JUMP);
                         break; // End the turn after a valid action
                     }
 
                 }
-            } else if (c == '\033') { // Escape key
+            } else if (key.code == KEY_ESCAPE || key.code == KEY_EOF) {
+                screen.invalidate();
                 cout << "\nEscape key pressed. Exiting the game...\n";
                 gameEnded = true;
                 break;
             }
         }
-        tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
     }
 }
 
-void Game::programTurn() {
-    string message = "\nProgram's turn.\n";
-    cout << message;
-    actionHistory.push_back(make_pair((userTeam == 'R') ? 'B' : 'R', getCurrentTime() + " Computer: " + message));
-    vector<Player*>& programTeam = (userTeam == 'R' ? blueTeam : redTeam);
-
-    // Find non-eliminated players
-    vector<Player*> activePlayers;
-    for (Player* player : programTeam) {
-        if (!player->isEliminated()) {
-            activePlayers.push_back(player);
+// Blocks until the next key; the input thread has been reading all along.
+// Effects advance meanwhile, but only while nothing has been printed below
+// the frame: presenting it would erase a prompt.
+KeyEvent Game::nextKey() {
+    KeyEvent key;
+    while (!input.wait(key, screen.isCurrent() ? effects.msUntilTick() : -1)) {
+        if (effects.update()) {
+            presentFrame();
         }
     }
+    return key;
+}
 
-    if (activePlayers.empty()) {
-        message = "No active players available for program's turn.\n";
-        cout << message;
-        actionHistory.push_back(make_pair((userTeam == 'R') ? 'B' : 'R', getCurrentTime() + " Computer: " + message));
-        return;
-    }
-
-    // Prioritize capturing the opponent's flag
-    pair<int, int> targetFlag = (programTeam == redTeam) ? blueFlag : redFlag;
-
-    // Sort players based on their distance to the opponent's flag
-    sort(activePlayers.begin(), activePlayers.end(), [&](Player* a, Player* b) {
-        int distA = abs(a->getX() - targetFlag.first) + abs(a->getY() - targetFlag.second);
-        int distB = abs(b->getX() - targetFlag.first) + abs(b->getY() - targetFlag.second);
-        return distA < distB;
-    });
-
-    bool actionTaken = false;
-
-    for (Player* player : activePlayers) {
-        if (player->isEliminated()) continue;
-
-        // Calculate the difference in positions
-        int deltaX = targetFlag.first - player->getX();
-        int deltaY = targetFlag.second - player->getY();
-
-        // Determine primary and secondary directions to move towards the flag
-        vector<int> moveDirections;
-        if (abs(deltaX) >= abs(deltaY)) {
-            if (deltaX > 0) moveDirections.push_back(RIGHT);
-            else if (deltaX < 0) moveDirections.push_back(LEFT);
-            if (deltaY > 0) moveDirections.push_back(DOWN);
-            else if (deltaY < 0) moveDirections.push_back(UP);
-        } else {
-            if (deltaY > 0) moveDirections.push_back(DOWN);
-            else if (deltaY < 0) moveDirections.push_back(UP);
-            if (deltaX > 0) moveDirections.push_back(RIGHT);
-            else if (deltaX < 0) moveDirections.push_back(LEFT);
-        }
-
-        // Check if any enemy players are within attack range
-        bool attackPossible = false;
-        vector<int> attackDirections = {UP, DOWN, LEFT, RIGHT};
-
-        for (int dir : attackDirections) {
-            for (int range = 1; range <= player->getAttackRange(); ++range) {
-                pair<bool, string> attackResult = player->attack(dir, range, board, rng);
-                if (attackResult.first) {
-                    // Attack was successful
-                    cout << attackResult.second << "\n";
-                    actionHistory.push_back(make_pair((userTeam == 'R') ? 'B' : 'R',
-                        getCurrentTime() + " Computer: " + attackResult.second));
-                    if (player->isShooterEliminated()) {
-                        message = "Program player " + to_string(player->getId())
-                                  + " is eliminated due to headshot penalty.\n";
-                        cout << message;
-                        actionHistory.push_back(make_pair((userTeam == 'R') ? 'B' : 'R',
-                            getCurrentTime() + " Computer: " + message));
-                    }
-                    actionTaken = true;
-                    attackPossible = true;
-                    break;
-                }
-            }
-            if (attackPossible)
+// An arrow key as a Direction, or -1 if the user pressed Escape instead
+int Game::readDirection() {
+    while (true) {
+        KeyEvent key = nextKey();
+        switch (key.code) {
+            case KEY_UP: return UP;
+            case KEY_DOWN: return DOWN;
+            case KEY_RIGHT: return RIGHT;
+            case KEY_LEFT: return LEFT;
+            case KEY_ESCAPE:
+            case KEY_EOF:
+                return -1;
+            default:
                 break;
         }
+    }
+}
 
-        if (!attackPossible) {
-            // Move towards the opponent's flag
-            int maxSteps = player->getMaxMovement();
-
-            bool moved = false;
-            for (int dir : moveDirections) {
-                std::string moveResult = player->move(dir, maxSteps, board, rng);
-                if (moveResult.find("Player") != std::string::npos) {
-                    // Movement was successful
-                    cout << moveResult << "\n";
-                    actionHistory.push_back(make_pair((userTeam == 'R') ? 'B' : 'R',
-                        getCurrentTime() + " Computer: " + moveResult));
-                    actionTaken = true;
-                    moved = true;
-                    break;
-                }
-            }
-
-            if (!moved) {
-                // If can't move towards the flag, try attacking nearby enemies
-                for (int dir : attackDirections) {
-                    for (int range = 1; range <= player->getAttackRange(); ++range) {
-                        pair<bool, string> attackResult = player->attack(dir, range, board, rng);
-                        if (attackResult.first) {
-                            // Attack was successful
-                            cout << attackResult.second << "\n";
-                            actionHistory.push_back(make_pair((userTeam == 'R') ? 'B' : 'R',
-                                getCurrentTime() + " Computer: " + attackResult.second));
-                            if (player->isShooterEliminated()) {
-                                message = "Program player " + to_string(player->getId())
-                                          + " is eliminated due to headshot penalty.\n";
-                                cout << message;
-                                actionHistory.push_back(make_pair((userTeam == 'R') ? 'B' : 'R',
-                                    getCurrentTime() + " Computer: " + message));
-                            }
-                            actionTaken = true;
-                            attackPossible = true;
-                            break;
-                        }
-                    }
-                    if (attackPossible)
-                        break;
-                }
-            }
+// Immediate input without pressing Enter; -1 if the user pressed Escape
+int Game::readOneOrTwo() {
+    while (true) {
+        KeyEvent key = nextKey();
+        if (key.code == KEY_CHAR && (key.ch == '1' || key.ch == '2')) {
+            cout << key.ch << "\n";
+            return key.ch - '0';
         }
-
-        if (actionTaken)
-            break; // Exit the loop after taking an action
+        if (key.code == KEY_ESCAPE || key.code == KEY_EOF) {
+            cout << "\n";
+            return -1;
+        }
+        cout << "\nInvalid input. Please enter 1 or 2: " << flush;
     }
+}
 
-    if (!actionTaken) {
-        message = "Program couldn't perform any actions.\n";
-        cout << message;
-        actionHistory.push_back(make_pair((userTeam == 'R') ? 'B' : 'R',
-            getCurrentTime() + " Computer: " + message));
+// Program actions are only turned into text when someone is watching
+void Game::logProgramAction(char team, JournalNote note) {
+    if (headless) {
+        return;
     }
-
-    if (actionTaken) {
-        // Play jump sound effect
-        Mix_PlayChannel(-1, jumpSound, 0);
-
-        // Update the team's moved flag based on the program's team
-        if (programTeam == redTeam) {
-            redTeamMoved = true;
+    if (note == NOTE_PROGRAM_TURN) {
+        if (effects.isEnabled()) {
+            effects.stopGroup(MESSAGE_GROUP); // Only this turn's messages are shown
         } else {
-            blueTeamMoved = true;
+            cout << "\n";
         }
     }
+    printProgramAction(journalNoteText(note));
+    journal.recordNote(match, team, SOURCE_COMPUTER, note);
 }
 
-
-bool Game::checkEndConditions() {
-    // Check if all players have moved at least once in the current turn
-    bool redAllMoved = true;
-    for (Player* p : redTeam) {
-        if (!p->isEliminated() && !p->hasMoved()) {
-            redAllMoved = false;
-            break;
-        }
-    }
-    bool blueAllMoved = true;
-    for (Player* p : blueTeam) {
-        if (!p->isEliminated() && !p->hasMoved()) {
-            blueAllMoved = false;
-            break;
-        }
+void Game::logProgramAction(char team, const MoveResult& result) {
+    if (!headless) {
+        printProgramAction(describeMove(result));
+        journal.recordMove(match, team, SOURCE_COMPUTER, result);
     }
+}
 
-    // Apply retreat logic only if all players have moved
-    if (redAllMoved && blueAllMoved) {
-        // Proceed with retreat checks as per your existing logic
-        // ...
+void Game::logProgramAction(char team, const AttackResult& result) {
+    if (headless) {
+        return;
+    }
+    printProgramAction(describeAttack(result));
+    if (result.hit() && result.location == HIT_HEAD) {
+        printProgramAction("Program player " + to_string(result.shooter) + " is eliminated due to headshot penalty.");
     }
+    journal.recordAttack(match, team, SOURCE_COMPUTER, result);
+}
 
-    // Check if any team reached opponent's flag area
-    for (Player* p : redTeam) {
-        if (!p->isEliminated() && p->getX() == blueFlag.first && p->getY() == blueFlag.second) {
-            displayBoardWithCursor(-1, -1, -1);
-            cout << "\nRed Team wins by capturing Blue's flag area!\n";
-            winner = "Red Team";
-            gameEnded = true;
-            return true;
+// Typed out below the board when effects are on, one line each
+void Game::printProgramAction(const string& message) {
+    if (!effects.isEnabled()) {
+        cout << message;
+        if (message.empty() || message.back() != '\n') {
+            cout << "\n";
         }
+        return;
     }
-    for (Player* p : blueTeam) {
-        if (!p->isEliminated() && p->getX() == redFlag.first && p->getY() == redFlag.second) {
-            displayBoardWithCursor(-1, -1, -1);
-            cout << "\nBlue Team wins by capturing Red's flag area!\n";
-            winner = "Blue Team";
-            gameEnded = true;
-            return true;
+    istringstream lines(message);
+    string line;
+    while (getline(lines, line)) {
+        if (!line.empty()) {
+            effects.add(unique_ptr<Animation>(new TypedLineAnimation(line, MESSAGE_TICKS_PER_CHAR, MESSAGE_HOLD_TICKS)),
+                        MESSAGE_GROUP);
         }
     }
+}
 
-    // Check if all players of one team are eliminated
-    bool redEliminated = true;
-    bool blueEliminated = true;
+bool Game::programTurn(char programTeamId) {
+    logProgramAction(programTeamId, NOTE_PROGRAM_TURN);
+    const PlayerTable& players = match.getPlayers();
 
-    for (Player* p : redTeam) {
-        if (!p->isEliminated()) {
-            redEliminated = false;
-            break;
-        }
-    }
-    for (Player* p : blueTeam) {
-        if (!p->isEliminated()) {
-            blueEliminated = false;
-            break;
+    // Find non-eliminated players
+    vector<int> activePlayers;
+    for (int player = match.teamBegin(programTeamId); player < match.teamEnd(programTeamId); ++player) {
+        if (!players.isEliminated(player)) {
+            activePlayers.push_back(player);
         }
     }
 
-    if (redEliminated) {
-        displayBoardWithCursor(-1, -1, -1);
-        cout << "\nBlue Team wins by eliminating all Red Team players!\n";
-        winner = "Blue Team";
-        gameEnded = true;
-        return true;
+    if (activePlayers.empty()) {
+        logProgramAction(programTeamId, NOTE_NO_ACTIVE_PLAYERS);
+        return false;
     }
-    if (blueEliminated) {
-        displayBoardWithCursor(-1, -1, -1);
-        cout << "\nRed Team wins by eliminating all Blue Team players!\n";
-        winner = "Red Team";
-        gameEnded = true;
-        return true;
-    }
-
-    // Check if only players in flag area remain
-    bool redOnlyAtFlag = true;
-    for (Player* p : redTeam) {
-        if (!p->isEliminated() && 
-            (p->getX() != redFlag.first || p->getY() != redFlag.second)) {
-            redOnlyAtFlag = false;
-            break;
+
+    bool actionTaken;
+    Action action;
+    if (ponderer.lookup(match, actionTaken, action)) {
+        // The position after the user's action was searched during their turn
+        if (actionTaken) {
+            performProgramAction(programTeamId, action);
         }
-    }
-    bool blueOnlyAtFlag = true;
-    for (Player* p : blueTeam) {
-        if (!p->isEliminated() && 
-            (p->getX() != blueFlag.first || p->getY() != blueFlag.second)) {
-            blueOnlyAtFlag = false;
-            break;
+        if (!headless) {
+            cout << "Search: reply pondered during your turn\n";
+        }
+    } else if (aiKinds[teamIndex(programTeamId)] == AI_MCTS) {
+        actionTaken = mcts.chooseAction(match, programTeamId, action);
+        if (actionTaken) {
+            performProgramAction(programTeamId, action);
+        }
+        const MctsStats& stats = mcts.getLastStats();
+        searchRollouts += stats.rollouts;
+        searchMs += stats.elapsedMs;
+        if (!headless) {
+            cout << "Search: " << stats.rollouts << " rollouts in " << static_cast<long long>(stats.elapsedMs)
+                 << " ms (" << static_cast<long long>(stats.rolloutsPerSecond()) << "/s)\n";
+        }
+    } else if (aiKinds[teamIndex(programTeamId)] == AI_EXPECTIMAX) {
+        actionTaken = expectimax.chooseAction(match, programTeamId, action);
+        if (actionTaken) {
+            performProgramAction(programTeamId, action);
         }
+        const ExpectimaxStats& stats = expectimax.getLastStats();
+        searchNodes += stats.nodes;
+        expectimaxMs += stats.elapsedMs;
+        if (!headless) {
+            cout << "Search: depth " << stats.depth << ", " << stats.nodes << " nodes, "
+                 << stats.tableHits << " table hits in " << static_cast<long long>(stats.elapsedMs) << " ms\n";
+        }
+    } else {
+        actionTaken = greedy.chooseAction(match, programTeamId, action);
+        if (actionTaken) {
+            performProgramAction(programTeamId, action);
+        }
+    }
+
+    if (!actionTaken) {
+        logProgramAction(programTeamId, NOTE_NO_ACTION);
     }
 
-    if (redOnlyAtFlag && !redEliminated) {
-        cout << "\nAll active Red Team players are at their flag area. Blue Team wins by opponent's retreat!\n";
-        winner = "Blue Team";
-        gameEnded = true;
-        return true;
+    if (actionTaken) {
+        // Play jump sound effect; a no-op without sound
+        audio->playEffect(SOUND_JUMP);
     }
-    if (blueOnlyAtFlag && !blueEliminated) {
-        cout << "\nAll active Blue Team players are at their flag area. Red Team wins by opponent's retreat!\n";
-        winner = "Red Team";
-        gameEnded = true;
-        return true;
+    return actionTaken;
+}
+
+void Game::performProgramAction(char programTeamId, const Action& action) {
+    if (action.kind == ACTION_ATTACK) {
+        AttackResult result = playAttack(action.player, action.direction, action.distance);
+        logProgramAction(programTeamId, result);
+    } else {
+        MoveResult result = playMove(action.player, action.direction, action.distance);
+        logProgramAction(programTeamId, result);
     }
+}
 
-    return false;
+// Interactive matches keep every change on the undo stack; headless ones
+// play straight through
+MoveResult Game::playMove(int player, int direction, int squares) {
+    MoveResult result = headless ? match.move(player, direction, squares)
+                                 : match.makeMove(player, direction, squares, undo);
+    greedy.moveMade(match, result);
+    recorder.recordMove(match, direction, squares, result);
+    return result;
 }
 
-Game::~Game() {
-    for (Player* p : redTeam)
-        delete p;
-    for (Player* p : blueTeam)
-        delete p;
+AttackResult Game::playAttack(int player, int direction, int squares) {
+    AttackResult result = headless ? match.attack(player, direction, squares)
+                                   : match.makeAttack(player, direction, squares, undo);
+    recorder.recordAttack(match, direction, squares, result);
+    if (effects.isEnabled()) {
+        animateShot(player, direction, squares, result);
+    }
+    return result;
+}
 
-    // Stop the music
-    Mix_HaltMusic();
+// The shot flies to its target, or as far as it went
+void Game::animateShot(int shooter, int direction, int squares, const AttackResult& result) {
+    if (!result.fired()) {
+        return;
+    }
+    const PlayerTable& players = match.getPlayers();
+    const Board& board = match.getBoard();
+    int fromX = players.getX(shooter);
+    int fromY = players.getY(shooter);
+    int toX = fromX;
+    int toY = fromY;
+    if (result.target >= 0) {
+        toX = players.getX(result.target);
+        toY = players.getY(result.target);
+    } else {
+        toX += direction == RIGHT ? squares : direction == LEFT ? -squares : 0;
+        toY += direction == DOWN ? squares : direction == UP ? -squares : 0;
+        toX = max(0, min(toX, board.getCols() - 1));
+        toY = max(0, min(toY, board.getRows() - 1));
+    }
+    effects.add(unique_ptr<Animation>(
+        new ProjectileAnimation(fromX, fromY, toX, toY, CELL_WIDTH, CELL_HEIGHT / 2, SHOT_TICKS_PER_CELL)));
+}
 
-    // Free the music and sound effects
-    if (bgm) {
-        Mix_FreeMusic(bgm);
-        bgm = nullptr;
+// Rolls the match back to the start of the user's previous turn, taking back
+// the program's reply as well. A recording cannot be rolled back, so undo is
+// off while recording.
+bool Game::undoLastTurn() {
+    if (recorder.isOpen() || turnStarts.size() < 2) {
+        return false;
     }
-    if (jumpSound) {
-        Mix_FreeChunk(jumpSound);
-        jumpSound = nullptr;
+    turnStarts.pop_back();
+    while (undo.size() > turnStarts.back()) {
+        match.unmake(undo);
     }
-    if (gameoverSound) {
-        Mix_FreeChunk(gameoverSound);
-        gameoverSound = nullptr;
+    turns -= 2;
+    greedy.reset(match);
+    journal.recordNote(match, userTeam, SOURCE_USER, NOTE_UNDO);
+    if (ponderer.isRunning()) {
+        startPondering(); // The old candidates start from the wrong board
     }
+    return true;
+}
 
-    // Close the audio device
-    Mix_CloseAudio();
+// Only the searching opponents are worth pondering for; greedy replies are instant
+void Game::startPondering() {
+    AiKind kind = aiKinds[teamIndex(opponentOf(userTeam))];
+    if (!ponderEnabled || kind == AI_GREEDY) {
+        return;
+    }
+    ponderer.start(match, userTeam, greedy,
+                   [this, kind](const Match& state, char team, const atomic<bool>& cancel, Action& best) {
+                       return kind == AI_MCTS ? mcts.chooseAction(state, team, best, &cancel)
+                                              : expectimax.chooseAction(state, team, best, &cancel);
+                   });
+}
 
-    // Quit SDL subsystems
-    SDL_Quit();
+void Game::endGame(const string& winningTeam, const string& message, bool showBoard) {
+    if (!headless) {
+        if (showBoard) {
+            displayBoardWithCursor(-1, -1, -1);
+        }
+        cout << message;
+    }
+    winner = winningTeam;
+    gameEnded = true;
 }
 
- // Start of Selection
-void Game::displayBoardWithCursor(int cursorX, int cursorY, int playerIndex) {
+bool Game::checkEndConditions() {
+    MatchOutcome outcome = match.checkEndConditions();
+    switch (outcome.reason) {
+        case FLAG_CAPTURED:
+            if (outcome.winner == 'R') {
+                endGame("Red Team", "\nRed Team wins by capturing Blue's flag area!\n", true);
+            } else {
+                endGame("Blue Team", "\nBlue Team wins by capturing Red's flag area!\n", true);
+            }
+            return true;
+        case TEAM_ELIMINATED:
+            if (outcome.winner == 'R') {
+                endGame("Red Team", "\nRed Team wins by eliminating all Blue Team players!\n", true);
+            } else {
+                endGame("Blue Team", "\nBlue Team wins by eliminating all Red Team players!\n", true);
+            }
+            return true;
+        case RETREAT:
+            if (outcome.winner == 'R') {
+                endGame("Red Team", "\nAll active Blue Team players are at their flag area. Red Team wins by opponent's retreat!\n", false);
+            } else {
+                endGame("Blue Team", "\nAll active Red Team players are at their flag area. Blue Team wins by opponent's retreat!\n", false);
+            }
+            return true;
+        case NOT_ENDED:
+            break;
+    }
+    return false;
+}
+
+// Fills the renderer with the board screen; `hints` adds the selection keys
+void Game::composeBoard(int cursorX, int cursorY, int playerIndex, bool hints) {
     const string RED = "\033[31m";
     const string BLUE = "\033[34m";
     const string BRIGHT_RED = "\033[91m";
     const string BRIGHT_BLUE = "\033[94m";
     const string RESET = "\033[0m";
-    const string HIGHLIGHT = "\033[43m"; // Yellow background for highlight
-
-    const int cellWidth = 20;   // Adjusted cell width as needed
-    const int cellHeight = 6;   // Adjusted cell height to accommodate coordinates
-
-    cout << "\nCurrent Board State:\n";
 
-    // Top border
-    cout << "+";
-    for (size_t x = 0; x < board[0].size(); ++x) {
-        cout << string(cellWidth, '-');
-        cout << "+";
+    const int cellWidth = CELL_WIDTH;
+    const int cellHeight = CELL_HEIGHT;
+
+    const Board& board = match.getBoard();
+    const PlayerTable& players = match.getPlayers();
+
+    // Only the cells that fit on the terminal are drawn, in a viewport that
+    // follows the cursor; a minimap then stands in for the rest of the board
+    int viewCols = board.getCols();
+    int viewRows = board.getRows();
+    int mapCols = 0;
+    int mapRows = 0;
+    int termRows, termCols;
+    if (terminalSize(termRows, termCols)) {
+        int gridLines = termRows - 2 - PANEL_LINES - MESSAGE_LINES; // Title and top border
+        viewCols = clamp((termCols - 1) / (cellWidth + 1), 1, board.getCols());
+        viewRows = clamp(gridLines / (cellHeight + 1), 1, board.getRows());
+        if (viewCols < board.getCols() || viewRows < board.getRows()) {
+            mapCols = min({board.getCols(), termCols - 1, MINIMAP_MAX_COLS});
+            mapRows = min(board.getRows(), MINIMAP_MAX_ROWS);
+            viewRows = clamp((gridLines - mapRows - 1) / (cellHeight + 1), 1, board.getRows());
+        }
     }
-    cout << "\n";
-
-    for (size_t y = 0; y < board.size(); ++y) {
-        // For each line in the cell height
-        for (int h = 0; h < cellHeight; ++h) {
-            cout << "|";
-            for (size_t x = 0; x < board[y].size(); ++x) {
-                const vector<Player*>& playersInCell = board[y][x].getPlayers();
-                
-                // **Filter out eliminated players**
-                vector<Player*> activePlayersInCell;
-                for (Player* p : playersInCell) {
-                    if (!p->isEliminated()) {
-                        activePlayersInCell.push_back(p);
-                    }
+    if (board.inBounds(cursorX, cursorY)) {
+        viewX = min(viewX, cursorX);
+        viewX = max(viewX, cursorX - viewCols + 1);
+        viewY = min(viewY, cursorY);
+        viewY = max(viewY, cursorY - viewRows + 1);
+    }
+    viewX = clamp(viewX, 0, board.getCols() - viewCols);
+    viewY = clamp(viewY, 0, board.getRows() - viewRows);
+
+    screen.beginFrame(viewCols, viewRows, cellWidth, cellHeight);
+    string& title = screen.titleLine();
+    title = "Current Board State:";
+    if (mapRows > 0) {
+        title += " columns " + to_string(viewX) + "-" + to_string(viewX + viewCols - 1) + ", rows "
+            + to_string(viewY) + "-" + to_string(viewY + viewRows - 1) + " of "
+            + to_string(board.getCols()) + "x" + to_string(board.getRows());
+    }
+
+    // Cell lines are copied from the glyph caches; nothing is formatted here
+    setCoordinateView(viewCols, viewRows);
+    for (int y = viewY; y < viewY + viewRows; ++y) {
+        for (int x = viewX; x < viewX + viewCols; ++x) {
+            const Cell& cell = board.at(x, y);
+            int h = 0;
+            // One line per active player, in arrival order
+            for (int k = 0; k < cell.size() && h < cellHeight; ++k) {
+                int p = cell[k];
+                if (players.isEliminated(p)) {
+                    continue;
                 }
-
-                string cellContent;
-                if (h < (int)activePlayersInCell.size()) {
-                    // Display active players
-                    Player* p = activePlayersInCell[h];
-                    string teamColor;
-                    if (p->getTeam() == 'R') {
-                        teamColor = (p->getTeam() == userTeam) ? BRIGHT_RED : RED;
-                    } else {
-                        teamColor = (p->getTeam() == userTeam) ? BRIGHT_BLUE : BLUE;
-                    }
-                    string playerRepresentation = p->getEmojiRepresentation();
-
-                    // Highlight only the individual selected player
-                    if ((int)x == cursorX && (int)y == cursorY && playerIndex == h) {
-                        playerRepresentation = HIGHLIGHT + playerRepresentation + RESET;
-                    }
-
-                    string content = teamColor + playerRepresentation + RESET;
-
-                    // Ensure the player representation line keeps the same width
-                    int contentDisplayWidth = getDisplayWidth(content);
-                    int paddingTotal = cellWidth - 10;
-                    if (paddingTotal > 0) {
-                        int paddingLeft = paddingTotal / 2;
-                        int paddingRight = paddingTotal - paddingLeft;
-                        content = string(paddingLeft, ' ') + content + string(paddingRight, ' ');
-                    } else {
-                        // Trim content if it's too long
-                        content = content.substr(0, cellWidth);
-                    }
-                    cellContent = content;
-                } else if (h == cellHeight - 1) {
-                    // Display coordinates at the bottom of the cell
-                    string coord = "(" + to_string(x) + "," + to_string(y) + ")";
-                    // Center align the coordinate
-                    int contentDisplayWidth = getDisplayWidth(coord);
-                    int paddingTotal = cellWidth - contentDisplayWidth;
-                    if (paddingTotal > 0) {
-                        int paddingLeft = paddingTotal / 2;
-                        int paddingRight = paddingTotal - paddingLeft;
-                        coord = string(paddingLeft, ' ') + coord + string(paddingRight, ' ');
-                    } else {
-                        coord = coord.substr(0, cellWidth);
-                    }
-                    cellContent = coord;
-                } else {
-                    // Empty line
-                    cellContent = string(cellWidth, ' ');
-                }
-
-                cout << cellContent << "|";
+                // Highlight only the individual selected player
+                bool highlighted = x == cursorX && y == cursorY && playerIndex == h;
+                screen.cellLine(x - viewX, y - viewY, h) = glyphFor(p).cellLine[highlighted];
+                h++;
+            }
+            for (; h < cellHeight; ++h) {
+                // Coordinates at the bottom of the cell
+                screen.cellLine(x - viewX, y - viewY, h) = h == cellHeight - 1 ? coordinateLine(x, y) : blankLine;
             }
-            cout << "\n";
         }
+    }
 
-        // Add horizontal separator between rows
-        cout << "+";
-        for (size_t x = 0; x < board[0].size(); ++x) {
-            cout << string(cellWidth, '-');
-            cout << "+";
-        }
-        cout << "\n";
+    if (mapRows > 0) {
+        composeMinimap(mapCols, mapRows, viewCols, viewRows);
     }
 
     // Display selected player information
-    if (cursorX >= 0 && cursorY >= 0 && cursorY < (int)board.size() && cursorX < (int)board[0].size()) {
-        const vector<Player*>& playersInCell = board[cursorY][cursorX].getPlayers();
-        if (playerIndex >= 0 && playerIndex < (int)playersInCell.size()) {
-            Player* selectedPlayer = playersInCell[playerIndex];
-            string teamColor = (selectedPlayer->getTeam() == 'R') 
-                ? ((selectedPlayer->getTeam() == userTeam) ? BRIGHT_RED : RED) 
-                : ((selectedPlayer->getTeam() == userTeam) ? BRIGHT_BLUE : BLUE);
-            cout << "Selected Player: " << teamColor
-                 << selectedPlayer->getEmojiRepresentation() << RESET
-                 << " (ID: " << selectedPlayer->getId()
-                 << ", Team: " << (selectedPlayer->getTeam() == 'R' ? RED + "Red" + RESET : BLUE + "Blue" + RESET)
-                 << ", Position: (" << selectedPlayer->getX() << ", " << selectedPlayer->getY() << "))\n";
+    if (board.inBounds(cursorX, cursorY)) {
+        const Cell& cell = board.at(cursorX, cursorY);
+        if (playerIndex >= 0 && playerIndex < cell.size()) {
+            int selectedPlayer = cell[playerIndex];
+            char selectedTeam = players.getTeam(selectedPlayer);
+            screen.addLine() = "Selected Player: " + glyphFor(selectedPlayer).label
+                + " (ID: " + to_string(selectedPlayer)
+                + ", Team: " + (selectedTeam == 'R' ? RED + "Red" + RESET : BLUE + "Blue" + RESET)
+                + ", Position: (" + to_string(players.getX(selectedPlayer)) + ", "
+                + to_string(players.getY(selectedPlayer)) + "))";
         } else {
-            cout << "No player selected. Current cursor position: (" << cursorX << ", " << cursorY << ")\n";
+            screen.addLine() = "No player selected. Current cursor position: (" + to_string(cursorX) + ", "
+                + to_string(cursorY) + ")";
         }
     }
 
     // Display action history with colored team actions
-    cout << "\nAction History:\n";
-    int startIdx = max(0, (int)actionHistory.size() - 3);
-    for (int i = startIdx; i < (int)actionHistory.size(); ++i) {
-        char actionTeam = actionHistory[i].first;
-        const string& action = actionHistory[i].second;
+    screen.addLine();
+    screen.addLine() = "Action History:";
+    for (int back = min(journal.size(), 3) - 1; back >= 0; --back) {
+        const JournalEvent& event = journal.recent(back);
+        char actionTeam = event.team;
+        string action = journal.format(event);
 
-        string coloredAction;
         if (actionTeam == 'R') {
-            coloredAction = RED + action + RESET;
+            screen.addLine() = RED + action + RESET;
         } else if (actionTeam == 'B') {
-            coloredAction = BLUE + action + RESET;
+            screen.addLine() = BLUE + action + RESET;
         } else {
-            coloredAction = action;
+            screen.addLine() = action;
         }
-        cout << coloredAction << "\n";
     }
 
     // **Display team stats**
-    cout << "\n\033[1mTeam Stats:\033[0m\n";
+    screen.addLine();
+    screen.addLine() = "\033[1mTeam Stats:\033[0m";
+
+    // Team counters and eliminated rosters are maintained by the match. Only
+    // the count and the latest few IDs are shown, so the panel costs the same
+    // on any team size.
+    auto displayTeamStats = [&](char team, const string& color, const char* name) {
+        const TeamStats& stats = match.getTeamStats(team);
+        screen.addLine() = color + name + " Team - Active: " + to_string(stats.active) + RESET;
+        if (!stats.eliminated.empty()) {
+            size_t shown = min(stats.eliminated.size(), static_cast<size_t>(STATS_RECENT_ELIMINATIONS));
+            string& line = screen.addLine();
+            line = color + "Eliminated: " + to_string(stats.eliminated.size());
+            line += shown < stats.eliminated.size() ? ", latest: " : ": ";
+            for (auto it = stats.eliminated.end() - shown; it != stats.eliminated.end(); ++it) {
+                int p = *it;
+                line += to_string(p) + " (" + eliminationReasonText(players.getEliminationReason(p)) + ")  ";
+            }
+            line += RESET;
+        }
+    };
 
-    // Collect eliminated players with reasons
-    vector<string> redEliminatedPlayers;
-    vector<string> blueEliminatedPlayers;
+    // Display Red Team stats
+    displayTeamStats('R', RED, "Red");
 
-    int redActive = 0, blueActive = 0;
-    for (Player* p : redTeam) {
-        if (p->isEliminated()) {
-            redEliminatedPlayers.push_back(
-                to_string(p->getId()) + " (" + p->getEliminationReason() + ")");
-        } else {
-            redActive++;
-        }
+    // Display Blue Team stats
+    displayTeamStats('B', BLUE, "Blue");
+
+    // Display current user's team color
+    screen.addLine();
+    screen.addLine() = "You are on the " + (userTeam == 'R' ? BRIGHT_RED + "Red Team" + RESET : BRIGHT_BLUE + "Blue Team" + RESET) + ".";
+
+    if (hints) {
+        screen.addLine() = "Use arrow keys to move (UP/DOWN between cells, LEFT/RIGHT between players in cell). Press Enter to select a player.";
+        screen.addLine() = "Press 'u' to undo your last turn.";
     }
-    for (Player* p : blueTeam) {
-        if (p->isEliminated()) {
-            blueEliminatedPlayers.push_back(
-                to_string(p->getId()) + " (" + p->getEliminationReason() + ")");
-        } else {
-            blueActive++;
-        }
+}
+
+// Centres `content`, `width` columns wide, in a cell line
+string centerInCell(const string& content, int width) {
+    int paddingTotal = max(0, CELL_WIDTH - width);
+    int paddingLeft = paddingTotal / 2;
+    return string(paddingLeft, ' ') + content + string(paddingTotal - paddingLeft, ' ');
+}
+
+// Tokens only change with the hit count, so each player's cell lines are
+// built once and then reused until the player is hit (or the hit is undone)
+const Game::PlayerGlyph& Game::glyphFor(int player) {
+    const string RED = "\033[31m";
+    const string BLUE = "\033[34m";
+    const string BRIGHT_RED = "\033[91m";
+    const string BRIGHT_BLUE = "\033[94m";
+    const string RESET = "\033[0m";
+    const string HIGHLIGHT = "\033[43m"; // Yellow background for highlight
+
+    const PlayerTable& players = match.getPlayers();
+    if (glyphs.size() != static_cast<size_t>(players.size())) {
+        glyphs.assign(players.size(), PlayerGlyph());
+    }
+    PlayerGlyph& glyph = glyphs[player];
+    int hits = players.getHitsToExtremities(player);
+    if (glyph.hits == hits) {
+        return glyph;
     }
 
-    // Display Red Team stats
-    cout << RED << "Red Team - Active: " << redActive << RESET << "\n";
-    if (!redEliminatedPlayers.empty()) {
-        cout << RED << "Eliminated: ";
-        for (const string& playerInfo : redEliminatedPlayers) {
-            cout << playerInfo << "  ";
+    string teamColor;
+    if (players.getTeam(player) == 'R') {
+        teamColor = (players.getTeam(player) == userTeam) ? BRIGHT_RED : RED;
+    } else {
+        teamColor = (players.getTeam(player) == userTeam) ? BRIGHT_BLUE : BLUE;
+    }
+    string representation = getEmojiRepresentation(player);
+    int width = getDisplayWidth(representation);
+    glyph.hits = hits;
+    glyph.label = teamColor + representation + RESET;
+    glyph.cellLine[0] = centerInCell(glyph.label, width);
+    glyph.cellLine[1] = centerInCell(teamColor + HIGHLIGHT + representation + RESET + RESET, width);
+    return glyph;
+}
+
+void Game::setCoordinateView(int viewCols, int viewRows) {
+    if (viewX == coordViewX && viewY == coordViewY && viewCols == coordViewCols && viewRows == coordViewRows) {
+        return;
+    }
+    coordViewX = viewX;
+    coordViewY = viewY;
+    coordViewCols = viewCols;
+    coordViewRows = viewRows;
+    coordLines.resize(static_cast<size_t>(viewCols) * viewRows);
+    for (string& line : coordLines) {
+        line.clear(); // Keeps the buffer for the label that replaces it
+    }
+}
+
+// (x, y) must be inside the view last passed to setCoordinateView()
+const string& Game::coordinateLine(int x, int y) {
+    string& line = coordLines[static_cast<size_t>(y - coordViewY) * coordViewCols + (x - coordViewX)];
+    if (line.empty()) {
+        string coord = "(" + to_string(x) + "," + to_string(y) + ")";
+        line = centerInCell(coord, getDisplayWidth(coord));
+    }
+    return line;
+}
+
+// The whole board at up to mapCols x mapRows characters, each one a block of
+// cells: R or B if only that team has active players there, * if both do.
+// Counted from the player list, so it costs the same on any board size, and
+// only after the position changed; the blocks under the viewport are shown
+// in reverse video.
+void Game::composeMinimap(int mapCols, int mapRows, int viewCols, int viewRows) {
+    const Board& board = match.getBoard();
+    const PlayerTable& players = match.getPlayers();
+    int blockCols = (board.getCols() + mapCols - 1) / mapCols;
+    int blockRows = (board.getRows() + mapRows - 1) / mapRows;
+    mapCols = (board.getCols() + blockCols - 1) / blockCols;
+    mapRows = (board.getRows() + blockRows - 1) / blockRows;
+
+    // Positions and eliminations are all in the hash, so a frame that only
+    // moved the cursor or the view reuses the counts
+    if (match.getHash() != minimapHash || blockCols != minimapBlockCols || blockRows != minimapBlockRows) {
+        minimapHash = match.getHash();
+        minimapBlockCols = blockCols;
+        minimapBlockRows = blockRows;
+        minimapCounts.assign(static_cast<size_t>(mapCols) * mapRows * 2, 0);
+        for (int p = 0; p < players.size(); ++p) {
+            if (!players.isEliminated(p)) {
+                size_t block = static_cast<size_t>(players.getY(p) / blockRows) * mapCols + players.getX(p) / blockCols;
+                minimapCounts[block * 2 + teamIndex(players.getTeam(p))]++;
+            }
         }
-        cout << RESET << "\n";
     }
 
-    // Display Blue Team stats
-    cout << BLUE << "Blue Team - Active: " << blueActive << RESET << "\n";
-    if (!blueEliminatedPlayers.empty()) {
-        cout << BLUE << "Eliminated: ";
-        for (const string& playerInfo : blueEliminatedPlayers) {
-            cout << playerInfo << "  ";
+    screen.addLine() = "Minimap (" + to_string(blockCols) + "x" + to_string(blockRows) + " cells per character):";
+    for (int my = 0; my < mapRows; ++my) {
+        bool viewRow = my * blockRows < viewY + viewRows && (my + 1) * blockRows > viewY;
+        string& line = screen.addLine();
+        for (int mx = 0; mx < mapCols; ++mx) {
+            bool inView = viewRow && mx * blockCols < viewX + viewCols && (mx + 1) * blockCols > viewX;
+            size_t block = static_cast<size_t>(my) * mapCols + mx;
+            int red = minimapCounts[block * 2];
+            int blue = minimapCounts[block * 2 + 1];
+            if (inView) {
+                line += "\033[7m";
+            }
+            if (red > 0 && blue > 0) {
+                line += "\033[33m*";
+            } else if (red > 0) {
+                line += "\033[31mR";
+            } else if (blue > 0) {
+                line += "\033[34mB";
+            } else {
+                line += '.';
+            }
+            if (inView || red > 0 || blue > 0) {
+                line += "\033[0m";
+            }
         }
-        cout << RESET << "\n";
     }
+}
 
-    // Display current user's team color
-    cout << "\nYou are on the " << (userTeam == 'R' ? BRIGHT_RED + "Red Team" + RESET : BRIGHT_BLUE + "Blue Team" + RESET) << ".\n";
+// Redraws the whole screen, clearing whatever was printed since the last frame
+void Game::displayBoardWithCursor(int cursorX, int cursorY, int playerIndex) {
+    composeBoard(cursorX, cursorY, playerIndex, false);
+    screen.invalidate();
+    presentFrame();
+}
+
+// Rewrites only what changed since the last frame; callers make sure nothing
+// else was printed in between
+void Game::refreshBoard(int cursorX, int cursorY, int playerIndex, bool hints) {
+    composeBoard(cursorX, cursorY, playerIndex, hints);
+    presentFrame();
+}
+
+// The composed frame with the effects as of now over it; on effect ticks the
+// same frame is presented again without composing it
+void Game::presentFrame() {
+    screen.clearOverlays();
+    if (!effects.isIdle()) {
+        effects.update();
+        effects.drawOver(screen, viewX, viewY);
+    }
+    screen.present();
 }
 
 int Game::getVisibleLength(const string& s) const {
@@ -1306,7 +1083,12 @@ int Game::getVisibleLength(const string& s) const {
     return length;
 }
 
+// Enter skips it; the audio loads meanwhile either way
 void Game::displaySplashScreen() {
+    if (headless || !splashEnabled) {
+        return;
+    }
+
     const vector<string> splashFrames = {
         "  ______          _           _ _ ",
         " |  ____|        | |         | | |",
@@ -1327,19 +1109,25 @@ void Game::displaySplashScreen() {
     };
 
     for (int i = 0; i < 3; ++i) {
-        system("clear");
+        screen.clear();
         cout << "\033[1;31m";
         for (const string& line : splashFrames) {
             cout << line << "\n";
         }
-        cout << "\033[0m";
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        cout << "\033[0m" << "Press Enter to skip." << flush;
+        // Still line-buffered here, so stdin is readable once Enter is pressed
+        pollfd keyboard = {STDIN_FILENO, POLLIN, 0};
+        if (::poll(&keyboard, 1, 1000) > 0) {
+            string skipped;
+            getline(cin, skipped); // Not an answer to the first setup question
+            break;
+        }
     }
-    system("clear");
+    screen.clear();
 }
 
 void Game::displayGameOverScreen() {
-    system("clear");
+    screen.clear();
     const vector<string> gameOverText = {
         "   _____                        ____                 ",
         "  / ____|                      / __ \\                ",
@@ -1356,84 +1144,13 @@ void Game::displayGameOverScreen() {
     cout << "\033[0m";
 }
 
-void Game::animateText(const string& text) {
-    for (char c : text) {
-        cout << c << flush;
-        std::this_thread::sleep_for(std::chrono::milliseconds(30));
-    }
-    cout << endl;
-}
-
-void Game::displayAttackAnimation(int fromX, int fromY, int toX, int toY) {
-    int dx = toX - fromX;
-    int dy = toY - fromY;
-    int steps = max(abs(dx), abs(dy));
-    double xIncrement = dx / (double)steps;
-    double yIncrement = dy / (double)steps;
-    double x = fromX;
-    double y = fromY;
-
-    for (int i = 0; i <= steps; ++i) {
-        system("clear");
-        displayBoardWithCursor(-1, -1, -1);
-        int projX = round(x);
-        int projY = round(y);
-        if (projY >= 0 && projY < board.size() && projX >= 0 && projX < board[0].size()) {
-            cout << "\033[" << projY + 3 << ";" << (projX * 15 + 2) << "H" << " o ";
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        x += xIncrement;
-        y += yIncrement;
-    }
-}
-
-void Game::playMusic(const std::string& musicFilePath) {
-    // Initialize SDL2
-    if (SDL_Init(SDL_INIT_AUDIO) < 0) {
-        std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
-        return;
-    }
-
-    // Initialize SDL_mixer
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
-        std::cerr << "SDL_mixer could not initialize! SDL_mixer Error: " << Mix_GetError() << std::endl;
-        SDL_Quit();
-        return;
-    }
-
-    // Load music file
-    bgm = Mix_LoadMUS(musicFilePath.c_str());
-    if (!bgm) {
-        std::cerr << "Failed to load music! SDL_mixer Error: " << Mix_GetError() << std::endl;
-        Mix_CloseAudio();
-        SDL_Quit();
-        return;
-    }
-
-    // Play music
-    if (Mix_PlayMusic(bgm, -1) == -1) { // -1 to loop indefinitely
-        std::cerr << "Mix_PlayMusic failed: " << Mix_GetError() << std::endl;
-    }
-
-    // Note: Remove the blocking cin.get() call
-    // The function now starts the music and returns immediately
-}
-
-void Game::stopMusic() {
-    // Stop the music
-    Mix_HaltMusic();
-
-    // Free the music
-    if (bgm) {
-        Mix_FreeMusic(bgm);
-        bgm = nullptr;
-    }
-
-    // Close the audio device
-    Mix_CloseAudio();
-
-    // Quit SDL subsystems
-    SDL_Quit();
+string Game::getEmojiRepresentation(int player) const {
+    const PlayerTable& players = match.getPlayers();
+    string expertEmoji = players.isExpert(player) ? "🎯" : "🔰";
+    string speedEmoji = players.isFast(player) ? "🏃" : "🐢";
+    string hits = "(" + to_string(players.getHitsToExtremities(player)) + ")";
+    string idStr = to_string(player);
+    return expertEmoji + speedEmoji + hits + "[" + idStr + "]";
 }
 
 int Game::getDisplayWidth(const string& s) const {
@@ -1470,17 +1187,246 @@ int Game::getDisplayWidth(const string& s) const {
     return width;
 }
 
-void Game::resetPlayersMovedFlag() {
-    for (Player* p : redTeam) {
-        p->resetMoved();
+void Game::runHeadless(int numRows, int numCols, int playersPerTeam, int maxTurns) {
+    match.setup(numRows, numCols, playersPerTeam);
+    greedy.reset(match);
+    recorder.writeHeader(match);
+
+    // Same starting-team draw as play(), but both teams are program-controlled
+    char currentTeam = match.random(-1, RNG_START_TEAM) < 0.5 ? 'R' : 'B';
+
+    // Ends like playGreedyMatch(): two idle plies in a row leave the position
+    // as it was, and a side with no action cannot find one in it again
+    int idlePlies = 0;
+    while (!gameEnded && turns < maxTurns) {
+        match.resetPlayersMovedFlag();
+        if (programTurn(currentTeam)) {
+            idlePlies = 0;
+        } else if (++idlePlies == 2) {
+            break;
+        }
+        if (gameEnded || checkEndConditions()) break;
+        currentTeam = (currentTeam == 'R' ? 'B' : 'R');
+        turns++;
     }
-    for (Player* p : blueTeam) {
-        p->resetMoved();
+
+    if (!gameEnded) {
+        winner = "Draw";
+    }
+    cout << "rows=" << numRows << " cols=" << numCols << " players=" << playersPerTeam
+         << " winner=" << (winner == "Red Team" ? "Red" : winner == "Blue Team" ? "Blue" : "Draw")
+         << " turns=" << turns;
+    if (searchMs > 0) {
+        cout << " rollouts_per_sec=" << static_cast<long long>(searchRollouts * 1000.0 / searchMs);
+    }
+    if (expectimaxMs > 0) {
+        cout << " nodes_per_sec=" << static_cast<long long>(searchNodes * 1000.0 / expectimaxMs);
     }
+    cout << "\n";
 }
 
-int main() {
-    Game game;
+// Plays a recording back through the engine as fast as it goes, printing
+// every action and the board it leads to when `render` is set. Playback
+// starts at `fromRound`, reached through the nearest keyframe.
+bool Game::runReplay(ReplayReader& reader, bool render, uint32_t fromRound) {
+    const ReplayHeader& header = reader.getHeader();
+    string error;
+    auto seekStart = chrono::steady_clock::now();
+    if (!reader.seekToRound(match, fromRound, error)) {
+        cerr << "Cannot replay: " << error << "\n";
+        return false;
+    }
+    double seekMs = chrono::duration<double, milli>(chrono::steady_clock::now() - seekStart).count();
+    if (render) {
+        displayBoardWithCursor(-1, -1, -1);
+    }
+
+    auto start = chrono::steady_clock::now();
+    long long actions = 0;
+    uint32_t lastRound = match.getPlayers().getRound();
+    ReplayRecord record;
+    ReplayStep step;
+    while (reader.next(record)) {
+        if (!applyReplayRecord(match, record, step, error)) {
+            cerr << "Cannot replay action " << reader.getActionIndex() - 1 << " (round " << record.round << "): "
+                 << error << "\n";
+            return false;
+        }
+        actions++;
+        lastRound = record.round;
+        if (render) {
+            char team = match.getPlayers().getTeam(record.player);
+            if (step.kind == ACTION_ATTACK) {
+                journal.recordAttack(match, team, SOURCE_REPLAY, step.attack);
+            } else {
+                journal.recordMove(match, team, SOURCE_REPLAY, step.move);
+            }
+            refreshBoard(-1, -1, -1, false);
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    checkEndConditions();
+    cout << "seed=" << header.seed << " rows=" << header.rows << " cols=" << header.cols
+         << " players=" << header.playersPerTeam
+         << " winner=" << (winner == "Red Team" ? "Red" : winner == "Blue Team" ? "Blue" : "Draw")
+         << " actions=" << actions << " rounds=" << lastRound - 1;
+    if (fromRound > 1) {
+        cout << " from_round=" << fromRound << " seek_ms=" << seekMs;
+    }
+    if (seconds > 0) {
+        cout << " actions_per_sec=" << static_cast<long long>(actions / seconds);
+    }
+    cout << "\n";
+    return true;
+}
+
+void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [--seed N] [--headless --rows R --cols C --players P [--max-turns T]]\n"
+         << "       [--ai AI] [--red-ai AI] [--blue-ai AI] (AI: greedy, mcts or expectimax)\n"
+         << "       [--ai-budget-ms MS] [--ai-threads N] [--no-ponder] [--no-splash]\n"
+         << "       [--no-sound] [--no-effects] [--record FILE]\n"
+         << "       " << program << " --replay FILE [--from-round R] [--headless]\n";
+}
+
+bool parseAiKind(const string& name, AiKind& kind) {
+    if (name == "greedy") kind = AI_GREEDY;
+    else if (name == "mcts") kind = AI_MCTS;
+    else if (name == "expectimax") kind = AI_EXPECTIMAX;
+    else return false;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    bool headless = false;
+    uint64_t seed = freshSeed();
+    int rows = 8, cols = 8, players = 4, maxTurns = 100000;
+    AiKind programAi = AI_GREEDY;
+    AiKind redAi = AI_GREEDY, blueAi = AI_GREEDY;
+    bool redAiSet = false, blueAiSet = false;
+    MctsConfig mctsConfig;
+    ExpectimaxConfig expectimaxConfig;
+    string recordPath, replayPath;
+    uint32_t fromRound = 1;
+    bool ponder = true;
+    bool splash = true;
+    bool sound = true;
+    bool animations = true;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--headless") {
+            headless = true;
+            continue;
+        }
+        if (arg == "--no-ponder") {
+            ponder = false;
+            continue;
+        }
+        if (arg == "--no-splash") {
+            splash = false;
+            continue;
+        }
+        if (arg == "--no-sound") {
+            sound = false;
+            continue;
+        }
+        if (arg == "--no-effects") {
+            animations = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        try {
+            if (arg == "--seed") seed = stoull(argv[++i]);
+            else if (arg == "--rows") rows = stoi(argv[++i]);
+            else if (arg == "--cols") cols = stoi(argv[++i]);
+            else if (arg == "--players") players = stoi(argv[++i]);
+            else if (arg == "--max-turns") maxTurns = stoi(argv[++i]);
+            else if (arg == "--record") recordPath = argv[++i];
+            else if (arg == "--replay") replayPath = argv[++i];
+            else if (arg == "--from-round") {
+                int round = stoi(argv[++i]);
+                if (round <= 0) {
+                    cerr << "Invalid value for " << arg << ": " << argv[i] << "\n";
+                    return 1;
+                }
+                fromRound = static_cast<uint32_t>(round);
+            }
+            else if (arg == "--ai-budget-ms") mctsConfig.budgetMs = expectimaxConfig.budgetMs = stoi(argv[++i]);
+            else if (arg == "--ai-threads") mctsConfig.threads = expectimaxConfig.threads = stoi(argv[++i]);
+            else if (arg == "--ai" || arg == "--red-ai" || arg == "--blue-ai") {
+                AiKind kind;
+                if (!parseAiKind(argv[++i], kind)) {
+                    cerr << "Unknown AI for " << arg << ": " << argv[i] << "\n";
+                    return 1;
+                }
+                if (arg == "--ai") programAi = kind;
+                else if (arg == "--red-ai") { redAi = kind; redAiSet = true; }
+                else { blueAi = kind; blueAiSet = true; }
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } catch (const exception& e) {
+            cerr << "Invalid value for " << arg << ": " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    if (mctsConfig.budgetMs <= 0 || mctsConfig.threads < 0) {
+        cerr << "The AI budget must be positive and the thread count non-negative.\n";
+        return 1;
+    }
+
+    // Without --headless the replay is printed action by action
+    if (!replayPath.empty()) {
+        ReplayReader reader;
+        string error;
+        if (!reader.open(replayPath, error)) {
+            cerr << "Cannot replay: " << error << "\n";
+            return 1;
+        }
+        Game game(reader.getHeader().seed, true);
+        return game.runReplay(reader, !headless, fromRound) ? 0 : 1;
+    }
+
+    if (headless) {
+        if (!isValidSetup(rows, cols, players)) {
+            cerr << "Rows and columns must be 1-" << MAX_BOARD_SIDE << " and players 1-" << MAX_PLAYERS_PER_TEAM
+                 << ".\n";
+            return 1;
+        }
+        Game game(seed, true);
+        // --ai applies to both program-controlled teams unless overridden
+        game.setAi('R', redAiSet ? redAi : programAi);
+        game.setAi('B', blueAiSet ? blueAi : programAi);
+        game.setMctsConfig(mctsConfig);
+        game.setExpectimaxConfig(expectimaxConfig);
+        if (!recordPath.empty() && !game.recordTo(recordPath)) {
+            cerr << "Cannot write " << recordPath << "\n";
+            return 1;
+        }
+        cout << "seed=" << seed << " ";
+        game.runHeadless(rows, cols, players, maxTurns);
+        return 0;
+    }
+
+    Game game(seed, false);
+    game.setAi('R', programAi);
+    game.setAi('B', programAi);
+    game.setMctsConfig(mctsConfig);
+    game.setExpectimaxConfig(expectimaxConfig);
+    game.setPondering(ponder);
+    game.setSplash(splash);
+    game.setSound(sound);
+    game.setEffects(animations);
+    if (!recordPath.empty() && !game.recordTo(recordPath)) {
+        cerr << "Cannot write " << recordPath << "\n";
+        return 1;
+    }
     game.play();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include "mcts.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+// Tree nodes live in one arena per thread; children of a node are contiguous
+struct Node {
+    Action action; // Action that led here (unused for the root)
+    int32_t firstChild; // -1 until expanded
+    int32_t childCount;
+    int32_t visits;
+    char mover; // Team that played `action`
+    double value; // Sum of results from the mover's point of view
+};
+
+const size_t MAX_NODES_PER_THREAD = 1 << 18;
+
+bool sameAction(const Action& a, const Action& b) {
+    return a.player == b.player && a.kind == b.kind && a.direction == b.direction && a.distance == b.distance;
+}
+
+// The tree is open-loop, so an action stored in it may no longer be legal
+// after a different dice roll earlier on the path
+bool isStillLegal(const Match& state, const Action& action) {
+    Action legal[MAX_PLAYER_ACTIONS];
+    int count = generateLegalActions(state, action.player, legal);
+    for (int i = 0; i < count; ++i) {
+        if (sameAction(legal[i], action)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// One ply as the game drives it: a fresh round, then the side to move acts.
+// Both go onto `undo`, so the rollout can be taken back afterwards.
+void playPly(Match& state, const Action& action, vector<UndoEntry>& undo) {
+    state.makeNewRound(undo);
+    if (action.kind == ACTION_MOVE) {
+        state.makeMove(action.player, action.direction, action.distance, undo);
+    } else {
+        state.makeAttack(action.player, action.direction, action.distance, undo);
+    }
+}
+
+// True for moves that bring the player closer to `flag`
+bool isAdvancing(const Match& state, const Action& action, pair<int, int> flag) {
+    static const int dxs[] = {0, 0, -1, 0, 1}; // Indexed by Direction
+    static const int dys[] = {0, -1, 0, 1, 0};
+    if (action.kind != ACTION_MOVE) {
+        return false;
+    }
+    const PlayerTable& players = state.getPlayers();
+    int x = players.getX(action.player);
+    int y = players.getY(action.player);
+    int nx = x + dxs[action.direction] * action.distance;
+    int ny = y + dys[action.direction] * action.distance;
+    return abs(nx - flag.first) + abs(ny - flag.second) < abs(x - flag.first) + abs(y - flag.second);
+}
+
+// Cheap playout policy: usually shoot when someone is in range, otherwise
+// usually step towards the enemy flag, and occasionally do anything legal
+bool pickRolloutAction(const Match& state, char team, vector<Action>& scratch, mt19937& rng, Action& chosen) {
+    scratch.clear();
+    generateTeamActions(state, team, scratch);
+    if (scratch.empty()) {
+        return false;
+    }
+
+    uniform_int_distribution<> percent(0, 99);
+    pair<int, int> enemyFlag = state.getFlag(opponentOf(team));
+    int attacks = 0, advancing = 0;
+    for (const Action& action : scratch) {
+        if (action.kind == ACTION_ATTACK) {
+            attacks++;
+        } else if (isAdvancing(state, action, enemyFlag)) {
+            advancing++;
+        }
+    }
+
+    // The counts above guarantee a match; the last action only keeps every
+    // path returning one
+    auto pickNth = [&](int kind, bool onlyAdvancing, int n) -> const Action& {
+        for (const Action& action : scratch) {
+            if (action.kind != kind) continue;
+            if (onlyAdvancing && !isAdvancing(state, action, enemyFlag)) continue;
+            if (n-- == 0) {
+                return action;
+            }
+        }
+        return scratch.back();
+    };
+
+    if (attacks > 0 && percent(rng) < 80) {
+        chosen = pickNth(ACTION_ATTACK, false, uniform_int_distribution<>(0, attacks - 1)(rng));
+    } else if (advancing > 0 && percent(rng) < 85) {
+        chosen = pickNth(ACTION_MOVE, true, uniform_int_distribution<>(0, advancing - 1)(rng));
+    } else {
+        chosen = scratch[uniform_int_distribution<size_t>(0, scratch.size() - 1)(rng)];
+    }
+    return true;
+}
+
+// Grows one tree until the deadline and returns its root children
+void searchTree(const Match& root, char team, const MctsConfig& config,
+                chrono::steady_clock::time_point deadline, const atomic<bool>* cancel, unsigned int seed,
+                vector<Node>& rootChildren, long long& rollouts) {
+    vector<Node> tree;
+    tree.reserve(4096);
+    tree.push_back({Action(), -1, 0, 0, opponentOf(team), 0.0});
+
+    mt19937 rng(seed);
+    vector<Action> scratch;
+    vector<int> path;
+    vector<UndoEntry> undo; // Every ply since the root
+    undo.reserve(4 * static_cast<size_t>(config.rolloutDepth) + 64);
+    Match state = root; // The only copy; each iteration unmakes back to the root
+    rollouts = 0;
+
+    while (chrono::steady_clock::now() < deadline && !(cancel && cancel->load(memory_order_relaxed))) {
+        state.reseed((static_cast<uint64_t>(rng()) << 32) | rng());
+        path.assign(1, 0);
+        int node = 0;
+        char toMove = team;
+        bool ended = false;
+
+        // 1. Selection: follow UCT through expanded nodes
+        while (!ended && tree[node].firstChild >= 0 && tree[node].childCount > 0) {
+            const Node& parent = tree[node];
+            double logVisits = log(static_cast<double>(max(1, parent.visits)));
+            int best = -1;
+            double bestScore = -numeric_limits<double>::infinity();
+            for (int i = 0; i < parent.childCount; ++i) {
+                const Node& child = tree[parent.firstChild + i];
+                if (child.visits == 0) {
+                    best = parent.firstChild + i; // Try every child once, in order
+                    break;
+                }
+                double score = child.value / child.visits + config.exploration * sqrt(logVisits / child.visits);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = parent.firstChild + i;
+                }
+            }
+            if (!isStillLegal(state, tree[best].action)) {
+                break; // Roll out from here instead
+            }
+            playPly(state, tree[best].action, undo);
+            node = best;
+            path.push_back(node);
+            toMove = opponentOf(toMove);
+            ended = state.checkEndConditions().reason != NOT_ENDED;
+        }
+
+        // 2. Expansion: add every legal action of the side to move
+        if (!ended && tree[node].firstChild < 0 && tree.size() < MAX_NODES_PER_THREAD) {
+            scratch.clear();
+            generateTeamActions(state, toMove, scratch);
+            tree[node].firstChild = static_cast<int32_t>(tree.size());
+            tree[node].childCount = static_cast<int32_t>(scratch.size());
+            for (const Action& action : scratch) {
+                tree.push_back({action, -1, 0, 0, toMove, 0.0});
+            }
+            if (!scratch.empty()) {
+                int child = tree[node].firstChild + uniform_int_distribution<>(0, tree[node].childCount - 1)(rng);
+                playPly(state, tree[child].action, undo);
+                node = child;
+                path.push_back(node);
+                toMove = opponentOf(toMove);
+                ended = state.checkEndConditions().reason != NOT_ENDED;
+            }
+        }
+
+        // 3. Rollout with the cheap policy
+        int passes = 0;
+        for (int depth = 0; depth < config.rolloutDepth && !ended && passes < 2; ++depth) {
+            Action action;
+            if (pickRolloutAction(state, toMove, scratch, rng, action)) {
+                playPly(state, action, undo);
+                ended = state.checkEndConditions().reason != NOT_ENDED;
+                passes = 0;
+            } else {
+                passes++;
+            }
+            toMove = opponentOf(toMove);
+        }
+
+        // 4. Backpropagation
+        double result = evaluateForTeam(state, team);
+        for (int index : path) {
+            Node& visited = tree[index];
+            visited.visits++;
+            visited.value += (visited.mover == team) ? result : 1.0 - result;
+        }
+        while (!undo.empty()) {
+            state.unmake(undo);
+        }
+        rollouts++;
+    }
+
+    rootChildren.clear();
+    if (tree[0].firstChild >= 0) {
+        rootChildren.assign(tree.begin() + tree[0].firstChild,
+                            tree.begin() + tree[0].firstChild + tree[0].childCount);
+    }
+}
+
+} // namespace
+
+MctsSearch::MctsSearch(const MctsConfig& config) : config(config), searchCounter(0) {}
+
+bool MctsSearch::chooseAction(const Match& state, char team, Action& best, const atomic<bool>* cancel) {
+    auto start = chrono::steady_clock::now();
+    stats = MctsStats();
+
+    vector<Action> legal;
+    generateTeamActions(state, team, legal);
+    if (legal.empty()) {
+        return false;
+    }
+    if (legal.size() == 1) {
+        best = legal[0];
+        return true;
+    }
+
+    int threadCount = config.threads > 0 ? config.threads : static_cast<int>(thread::hardware_concurrency());
+    threadCount = max(1, threadCount);
+    auto deadline = start + chrono::milliseconds(config.budgetMs);
+    unsigned int searchSeed = ++searchCounter * 0x9E3779B9u;
+
+    // One independent tree per thread; the calling thread grows the first one
+    vector<vector<Node>> rootChildren(threadCount);
+    vector<long long> rollouts(threadCount, 0);
+    vector<thread> workers;
+    for (int t = 1; t < threadCount; ++t) {
+        workers.emplace_back(searchTree, cref(state), team, cref(config), deadline, cancel,
+                             searchSeed ^ (t * 0x85EBCA6Bu), ref(rootChildren[t]), ref(rollouts[t]));
+    }
+    searchTree(state, team, config, deadline, cancel, searchSeed, rootChildren[0], rollouts[0]);
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    // Every tree expanded the root from the same state, so children line up by index
+    vector<long long> visits(legal.size(), 0);
+    vector<double> values(legal.size(), 0.0);
+    for (int t = 0; t < threadCount; ++t) {
+        stats.rollouts += rollouts[t];
+        if (rootChildren[t].size() != legal.size()) continue;
+        for (size_t i = 0; i < legal.size(); ++i) {
+            visits[i] += rootChildren[t][i].visits;
+            values[i] += rootChildren[t][i].value;
+        }
+    }
+
+    size_t bestIndex = 0;
+    for (size_t i = 1; i < legal.size(); ++i) {
+        double mean = visits[i] ? values[i] / visits[i] : 0;
+        double bestMean = visits[bestIndex] ? values[bestIndex] / visits[bestIndex] : 0;
+        if (visits[i] > visits[bestIndex] || (visits[i] == visits[bestIndex] && mean > bestMean)) {
+            bestIndex = i;
+        }
+    }
+    best = legal[bestIndex];
+
+    stats.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return true;
+}
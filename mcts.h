@@ -0,0 +1,43 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <atomic>
+
+#include "engine.h"
+
+// Monte Carlo Tree Search opponent. Every search runs one independent tree per
+// thread (root parallelism) and stops at a hard wall-clock deadline; the root
+// statistics of all trees are then merged. Each thread copies the match once
+// and plays every iteration on that copy with make*(), unmaking back to the
+// root before the next one.
+// Attack outcomes are sampled through the match's own hit probabilities, so
+// the tree is open-loop: a node stands for an action sequence, not a state.
+
+struct MctsConfig {
+    int budgetMs = 200; // Wall-clock time per decision
+    int threads = 0; // 0 = one per hardware thread
+    int rolloutDepth = 60; // Plies simulated after leaving the tree
+    double exploration = 1.4; // UCT exploration constant
+};
+
+struct MctsStats {
+    long long rollouts = 0;
+    double elapsedMs = 0;
+    double rolloutsPerSecond() const { return elapsedMs > 0 ? rollouts * 1000.0 / elapsedMs : 0; }
+};
+
+class MctsSearch {
+private:
+    MctsConfig config;
+    MctsStats stats;
+    unsigned int searchCounter; // Varies the rollout seeds between decisions
+public:
+    explicit MctsSearch(const MctsConfig& config = MctsConfig());
+    // Picks an action for `team` in `state`. Returns false if it has none.
+    // Setting `cancel` ends the search early with the best action so far.
+    bool chooseAction(const Match& state, char team, Action& best, const std::atomic<bool>* cancel = nullptr);
+    const MctsStats& getLastStats() const { return stats; }
+    const MctsConfig& getConfig() const { return config; }
+};
+
+#endif
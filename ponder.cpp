@@ -0,0 +1,115 @@
+#include "ponder.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+namespace {
+
+bool sameAction(const Action& a, const Action& b) {
+    return a.player == b.player && a.kind == b.kind && a.direction == b.direction && a.distance == b.distance;
+}
+
+// Lower is likelier: the greedy choice, then shots, then moves by how much
+// closer they bring the player to the enemy flag
+long long likelihoodRank(const Match& state, const FlowField& field, const Action& action,
+                         bool hasPrediction, const Action& prediction) {
+    if (hasPrediction && sameAction(action, prediction)) {
+        return 0;
+    }
+    if (action.kind == ACTION_ATTACK) {
+        return 1;
+    }
+    const PlayerTable& players = state.getPlayers();
+    int x = players.getX(action.player);
+    int y = players.getY(action.player);
+    int toX = x + (action.direction == RIGHT ? action.distance : action.direction == LEFT ? -action.distance : 0);
+    int toY = y + (action.direction == DOWN ? action.distance : action.direction == UP ? -action.distance : 0);
+    // Unreachable cells sort last without overflowing
+    long long before = min<long long>(field.distance(x, y), INT32_MAX / 2);
+    long long after = min<long long>(field.distance(toX, toY), INT32_MAX / 2);
+    return 2 + (after - before) + INT32_MAX / 2;
+}
+
+} // namespace
+
+void Ponderer::start(const Match& state, char humanTeam, const GreedyPolicy& predictor, PonderSearch search) {
+    stop();
+    replies.clear();
+    pending = true;
+    worker = thread(&Ponderer::run, this, state, humanTeam, predictor, move(search));
+}
+
+void Ponderer::stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+    cancel.store(true);
+    worker.join();
+    cancel.store(false);
+}
+
+void Ponderer::run(Match root, char humanTeam, GreedyPolicy predictor, PonderSearch search) {
+    char programTeam = opponentOf(humanTeam);
+    vector<Action> candidates;
+    generateTeamActions(root, humanTeam, candidates);
+
+    Action prediction;
+    bool hasPrediction = predictor.chooseAction(root, humanTeam, prediction);
+    const FlowField& field = predictor.getField(humanTeam);
+    vector<pair<long long, size_t>> order;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        order.push_back({likelihoodRank(root, field, candidates[i], hasPrediction, prediction), i});
+    }
+    stable_sort(order.begin(), order.end(),
+                [](const pair<long long, size_t>& a, const pair<long long, size_t>& b) { return a.first < b.first; });
+
+    for (const pair<long long, size_t>& entry : order) {
+        if (cancel.load(memory_order_relaxed)) {
+            return;
+        }
+        Match position = root;
+        applyAction(position, candidates[entry.second]);
+        if (position.checkEndConditions().reason != NOT_ENDED) {
+            continue; // The program never gets to reply
+        }
+        position.resetPlayersMovedFlag(); // The program's round, as the game loop starts it
+
+        // Different actions can end in the same position, e.g. two missed shots
+        uint64_t hash = position.getHash();
+        uint32_t round = position.getPlayers().getRound();
+        bool known = any_of(replies.begin(), replies.end(),
+                            [&](const Reply& reply) { return reply.hash == hash && reply.round == round; });
+        if (known) {
+            continue;
+        }
+
+        Reply reply = {hash, round, false, Action()};
+        reply.found = search(position, programTeam, cancel, reply.action);
+        if (cancel.load(memory_order_relaxed)) {
+            return; // Cut short: not as good as a real search
+        }
+        replies.push_back(reply);
+        stats.positions++;
+    }
+}
+
+bool Ponderer::lookup(const Match& state, bool& found, Action& action) {
+    if (!pending) {
+        return false;
+    }
+    pending = false;
+    uint64_t hash = state.getHash();
+    uint32_t round = state.getPlayers().getRound();
+    for (const Reply& reply : replies) {
+        if (reply.hash == hash && reply.round == round) {
+            found = reply.found;
+            action = reply.action;
+            stats.hits++;
+            return true;
+        }
+    }
+    stats.misses++;
+    return false;
+}
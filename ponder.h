@@ -0,0 +1,61 @@
+#ifndef PONDER_H
+#define PONDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "engine.h"
+#include "greedy.h"
+
+// Thinking on the human's time. While the human picks an action, a
+// background thread plays the likeliest human actions on copies of the match,
+// starts the next round as the game loop does, and runs the program's search
+// on every resulting position. Draws are keyed by (round, player), so the
+// human's real action leads to exactly one of those positions if it was
+// pondered, and the program's turn takes the stored reply instead of
+// searching again.
+
+// Runs the program's search; must return soon after `cancel` is set
+typedef std::function<bool(const Match& state, char team, const std::atomic<bool>& cancel, Action& best)>
+    PonderSearch;
+
+struct PonderStats {
+    long long positions = 0; // Searched to the end of their budget
+    long long hits = 0; // Program turns answered from a pondered position
+    long long misses = 0; // Program turns after pondering that had to search anyway
+};
+
+class Ponderer {
+private:
+    struct Reply {
+        uint64_t hash; // Match::getHash() of the position
+        uint32_t round;
+        bool found; // The search had an action for the program
+        Action action;
+    };
+    std::thread worker;
+    std::atomic<bool> cancel;
+    std::vector<Reply> replies; // Written by the worker, read after stop()
+    bool pending; // start() was called and lookup() has not been yet
+    PonderStats stats;
+    void run(Match root, char humanTeam, GreedyPolicy predictor, PonderSearch search);
+public:
+    Ponderer() : cancel(false), pending(false) {}
+    ~Ponderer() { stop(); }
+    // Starts pondering `state`, where `humanTeam` is about to act; the
+    // predictor orders the human's options. Nothing else may use what
+    // `search` uses until stop().
+    void start(const Match& state, char humanTeam, const GreedyPolicy& predictor, PonderSearch search);
+    // Cancels the search in progress and waits for the worker
+    void stop();
+    bool isRunning() const { return worker.joinable(); }
+    // After stop(), at the start of the program's turn: true if `state` was
+    // pondered, with the search's answer in `found` and `action`
+    bool lookup(const Match& state, bool& found, Action& action);
+    const PonderStats& getStats() const { return stats; }
+};
+
+#endif
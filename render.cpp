@@ -0,0 +1,215 @@
+#include "render.h"
+
+#include <cerrno>
+#include <iostream>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// A 30x30 board with its panels fits without growing the buffer
+const size_t INITIAL_OUTPUT_CAPACITY = 256 * 1024;
+
+void appendNumber(string& out, int value) {
+    char digits[12];
+    int count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (count > 0) {
+        out += digits[--count];
+    }
+}
+
+} // namespace
+
+TerminalRenderer::TerminalRenderer()
+    : gridCols(0), gridRows(0), cellWidth(0), cellHeight(0), textCount(0), shownTextCount(0),
+      overlayTextCount(0), onScreen(false) {
+    out.reserve(INITIAL_OUTPUT_CAPACITY);
+}
+
+void TerminalRenderer::beginFrame(int cols, int rows, int width, int height) {
+    if (cols != gridCols || rows != gridRows || width != cellWidth || height != cellHeight) {
+        gridCols = cols;
+        gridRows = rows;
+        cellWidth = width;
+        cellHeight = height;
+        size_t lineCount = static_cast<size_t>(cols) * rows * height;
+        cellLines.assign(lineCount, string());
+        shownCellLines.assign(lineCount, string());
+        cellOverlay.assign(lineCount, -1);
+        overlaidCells.clear();
+        onScreen = false;
+    }
+    textCount = 0;
+}
+
+string& TerminalRenderer::addLine() {
+    if (textCount == static_cast<int>(textLines.size())) {
+        textLines.emplace_back();
+    }
+    string& line = textLines[textCount++];
+    line.clear();
+    return line;
+}
+
+void TerminalRenderer::clearOverlays() {
+    for (size_t index : overlaidCells) {
+        cellOverlay[index] = -1;
+    }
+    overlaidCells.clear();
+    overlayTextCount = 0;
+}
+
+string& TerminalRenderer::overlayCellLine(int x, int y, int line) {
+    size_t index = (static_cast<size_t>(y) * gridCols + x) * cellHeight + line;
+    if (cellOverlay[index] < 0) {
+        cellOverlay[index] = static_cast<int>(overlaidCells.size());
+        overlaidCells.push_back(index);
+        if (overlaidCells.size() > overlayLines.size()) {
+            overlayLines.emplace_back();
+        }
+    }
+    return overlayLines[cellOverlay[index]];
+}
+
+string& TerminalRenderer::addOverlayLine() {
+    if (overlayTextCount == static_cast<int>(overlayText.size())) {
+        overlayText.emplace_back();
+    }
+    string& line = overlayText[overlayTextCount++];
+    line.clear();
+    return line;
+}
+
+void TerminalRenderer::moveTo(int row, int col) {
+    out += "\033[";
+    appendNumber(out, row);
+    out += ';';
+    appendNumber(out, col);
+    out += 'H';
+}
+
+void TerminalRenderer::appendBorder() {
+    out += '+';
+    for (int x = 0; x < gridCols; ++x) {
+        out.append(cellWidth, '-');
+        out += '+';
+    }
+}
+
+void TerminalRenderer::appendTextLine(int row, const string& line) {
+    moveTo(row, 1);
+    out += line;
+    out += "\033[K"; // Rest of the old line
+}
+
+// Screen rows are 1-based: the title, the top border, then per grid row
+// cellHeight lines and a separator, then the text lines
+void TerminalRenderer::present() {
+    out.clear();
+    bool full = !onScreen;
+    if (full) {
+        out += "\033[H\033[2J";
+    }
+    if (full || title != shownTitle) {
+        appendTextLine(1, title);
+    }
+
+    const int gridTop = 2;
+    const int rowPitch = cellHeight + 1;
+    if (full) {
+        // Borders and cells together, one screen row at a time
+        moveTo(gridTop, 1);
+        appendBorder();
+        for (int y = 0; y < gridRows; ++y) {
+            for (int h = 0; h < cellHeight; ++h) {
+                moveTo(gridTop + 1 + y * rowPitch + h, 1);
+                out += '|';
+                for (int x = 0; x < gridCols; ++x) {
+                    size_t index = (static_cast<size_t>(y) * gridCols + x) * cellHeight + h;
+                    shownCellLines[index] = shownCell(index);
+                    out += shownCellLines[index];
+                    out += '|';
+                }
+            }
+            moveTo(gridTop + (y + 1) * rowPitch, 1);
+            appendBorder();
+        }
+    } else {
+        size_t index = 0;
+        for (int y = 0; y < gridRows; ++y) {
+            for (int x = 0; x < gridCols; ++x) {
+                for (int h = 0; h < cellHeight; ++h, ++index) {
+                    const string& line = shownCell(index);
+                    if (line != shownCellLines[index]) {
+                        moveTo(gridTop + 1 + y * rowPitch + h, 2 + x * (cellWidth + 1));
+                        out += line;
+                        shownCellLines[index] = line;
+                    }
+                }
+            }
+        }
+    }
+
+    const int textTop = gridTop + 1 + gridRows * rowPitch;
+    const int lineCount = textCount + overlayTextCount;
+    if (static_cast<int>(shownTextLines.size()) < lineCount) {
+        shownTextLines.resize(lineCount);
+    }
+    for (int j = 0; j < lineCount; ++j) {
+        const string& line = shownText(j);
+        if (full || j >= shownTextCount || line != shownTextLines[j]) {
+            appendTextLine(textTop + j, line);
+            shownTextLines[j] = line;
+        }
+    }
+    if (out.empty() && lineCount == shownTextCount) {
+        return; // The same frame again, e.g. an effect tick that moved nothing
+    }
+    // Drop whatever is left below: a longer previous frame or stray prompts
+    moveTo(textTop + lineCount, 1);
+    out += "\033[J";
+    writeOut();
+
+    shownTitle = title;
+    shownTextCount = lineCount;
+    onScreen = true;
+}
+
+void TerminalRenderer::clear() {
+    out.assign("\033[H\033[2J");
+    writeOut();
+    onScreen = false;
+}
+
+void TerminalRenderer::writeOut() {
+    cout.flush(); // Keep earlier stream output ahead of the frame
+    const char* data = out.data();
+    size_t left = out.size();
+    while (left > 0) {
+        ssize_t written = ::write(STDOUT_FILENO, data, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return; // Nothing sensible to do about a broken terminal
+        }
+        data += written;
+        left -= static_cast<size_t>(written);
+    }
+}
+
+bool terminalSize(int& rows, int& cols) {
+    winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_row == 0 || size.ws_col == 0) {
+        return false;
+    }
+    rows = size.ws_row;
+    cols = size.ws_col;
+    return true;
+}
@@ -0,0 +1,84 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <string>
+#include <vector>
+
+// The board screen, drawn without clearing the terminal. A frame is a title
+// line, a grid of bordered cells of fixed size and free text lines below it.
+// The renderer keeps the frame that is on screen and present() rewrites only
+// the cell lines and text lines that differ, each behind a cursor-positioning
+// escape. Output is built in one reused buffer and handed to the terminal
+// with a single write(), so an arrow key costs a few dozen bytes, not a
+// screenful. Animations are overlays on the frame: presenting the same frame
+// with the next step of an effect only rewrites the lines the effect touched.
+class TerminalRenderer {
+private:
+    int gridCols;
+    int gridRows;
+    int cellWidth;
+    int cellHeight;
+    // Frame being built and frame on screen. present() copies only the lines
+    // that changed into the shown frame, whose strings keep their capacity,
+    // and leaves the built frame as it is, so it can be presented again.
+    std::string title, shownTitle;
+    std::vector<std::string> cellLines, shownCellLines; // cellHeight per cell, row-major
+    std::vector<std::string> textLines, shownTextLines;
+    int textCount;
+    int shownTextCount;
+    // Effects over the built frame: an index into overlayLines per cell
+    // line, -1 where there is none, and text lines after the frame's own
+    std::vector<int> cellOverlay;
+    std::vector<size_t> overlaidCells;
+    std::vector<std::string> overlayLines;
+    std::vector<std::string> overlayText;
+    int overlayTextCount;
+    bool onScreen; // The shown frame is what the terminal displays
+    std::string out;
+    void moveTo(int row, int col);
+    void appendBorder();
+    void appendTextLine(int row, const std::string& line);
+    void writeOut();
+    const std::string& shownCell(size_t index) const {
+        return cellOverlay[index] < 0 ? cellLines[index] : overlayLines[cellOverlay[index]];
+    }
+    const std::string& shownText(int line) const {
+        return line < textCount ? textLines[line] : overlayText[line - textCount];
+    }
+public:
+    TerminalRenderer();
+    // Starts a frame of cols x rows cells. Every cell line and the title must
+    // be filled again before present(); a geometry other than the shown
+    // frame's forces a full redraw.
+    void beginFrame(int cols, int rows, int width, int height);
+    std::string& titleLine() { return title; }
+    // Line `line` of cell (x, y), to be filled with exactly `width` columns
+    std::string& cellLine(int x, int y, int line) {
+        return cellLines[(static_cast<size_t>(y) * gridCols + x) * cellHeight + line];
+    }
+    bool inGrid(int x, int y) const { return x >= 0 && x < gridCols && y >= 0 && y < gridRows; }
+    // Appends an empty text line below the grid, to be filled by the caller
+    std::string& addLine();
+    // Drops every effect drawn over the frame
+    void clearOverlays();
+    // Shown instead of line `line` of cell (x, y) until clearOverlays();
+    // exactly `width` columns, like the line it covers
+    std::string& overlayCellLine(int x, int y, int line);
+    // A text line shown after the frame's own until clearOverlays()
+    std::string& addOverlayLine();
+    // Puts the frame, with the effects over it, on screen and leaves the
+    // cursor just below it
+    void present();
+    // Something else was printed: the next present() redraws everything
+    void invalidate() { onScreen = false; }
+    // Nothing has been printed below the last frame since it was presented
+    bool isCurrent() const { return onScreen; }
+    // Blanks the terminal, for screens drawn with plain output
+    void clear();
+};
+
+// Size of the terminal on stdout, in lines and columns; false if stdout is
+// not a terminal
+bool terminalSize(int& rows, int& cols);
+
+#endif
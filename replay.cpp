@@ -0,0 +1,510 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[4] = {'P', 'B', 'R', 'P'};
+const char INDEX_MAGIC[4] = {'P', 'B', 'R', 'X'};
+const int FOOTER_SIZE = 16;
+const int INDEX_ENTRY_SIZE = 20;
+const int KEYFRAME_PLAYER_SIZE = 15;
+
+// Fixed-width little-endian encoding, whatever the host byte order
+void putBytes(string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void storeBytes(unsigned char* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out[i] = static_cast<unsigned char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint64_t getBytes(const unsigned char* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+void putDouble(string& out, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putBytes(out, bits, 8);
+}
+
+// Sequential reads from an istream; any short read sticks as a failure
+class Decoder {
+private:
+    istream& in;
+    bool failed;
+public:
+    explicit Decoder(istream& in) : in(in), failed(false) {}
+    bool ok() const { return !failed; }
+    uint64_t read(int bytes) {
+        unsigned char buffer[8] = {};
+        if (!in.read(reinterpret_cast<char*>(buffer), bytes)) {
+            failed = true;
+        }
+        return getBytes(buffer, bytes);
+    }
+    int32_t readInt() { return static_cast<int32_t>(read(4)); }
+    double readDouble() {
+        uint64_t bits = read(8);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+uint8_t attackOutcome(const AttackResult& result) {
+    return static_cast<uint8_t>(result.status | (result.location << 4));
+}
+
+void encodeRecord(const ReplayRecord& record, unsigned char* bytes) {
+    storeBytes(bytes, record.round, 4);
+    storeBytes(bytes + 4, static_cast<uint32_t>(record.player), 4);
+    bytes[8] = record.kind;
+    bytes[9] = record.direction;
+    bytes[10] = static_cast<unsigned char>(record.squares);
+    bytes[11] = record.outcome;
+}
+
+void decodeRecord(const unsigned char* bytes, ReplayRecord& record) {
+    record.round = static_cast<uint32_t>(getBytes(bytes, 4));
+    record.player = static_cast<int32_t>(getBytes(bytes + 4, 4));
+    record.kind = bytes[8];
+    record.direction = bytes[9];
+    record.squares = static_cast<int8_t>(bytes[10]);
+    record.outcome = bytes[11];
+}
+
+// Checks every field against the recorded board, so a corrupt keyframe
+// cannot index out of it
+bool decodeKeyframe(const unsigned char* bytes, size_t size, const ReplayHeader& header,
+                    MatchSnapshot& snapshot, uint64_t& hash) {
+    size_t count = header.roster.size();
+    if (size < 8 + count * KEYFRAME_PLAYER_SIZE) {
+        return false;
+    }
+    hash = getBytes(bytes, 8);
+    const unsigned char* at = bytes + 8;
+    snapshot.xs.resize(count);
+    snapshot.ys.resize(count);
+    snapshot.slots.resize(count);
+    snapshot.extremityHits.resize(count);
+    snapshot.eliminationReasons.resize(count);
+    snapshot.movedRounds.resize(count);
+    for (size_t id = 0; id < count; ++id, at += KEYFRAME_PLAYER_SIZE) {
+        snapshot.xs[id] = static_cast<int32_t>(getBytes(at, 4));
+        snapshot.ys[id] = static_cast<int32_t>(getBytes(at + 4, 4));
+        snapshot.slots[id] = at[8];
+        snapshot.extremityHits[id] = at[9];
+        snapshot.eliminationReasons[id] = at[10];
+        snapshot.movedRounds[id] = static_cast<uint32_t>(getBytes(at + 11, 4));
+        if (snapshot.xs[id] < 0 || snapshot.xs[id] >= header.cols || snapshot.ys[id] < 0
+            || snapshot.ys[id] >= header.rows || snapshot.slots[id] >= Cell::CAPACITY
+            || snapshot.eliminationReasons[id] > HEADSHOT_PENALTY) {
+            return false;
+        }
+    }
+    const unsigned char* end = bytes + size;
+    for (vector<int32_t>& eliminated : snapshot.eliminated) {
+        if (end - at < 4) {
+            return false;
+        }
+        uint64_t eliminatedCount = getBytes(at, 4);
+        at += 4;
+        if (eliminatedCount > count || static_cast<uint64_t>(end - at) < 4 * eliminatedCount) {
+            return false;
+        }
+        eliminated.resize(eliminatedCount);
+        for (int32_t& id : eliminated) {
+            id = static_cast<int32_t>(getBytes(at, 4));
+            at += 4;
+            if (id < 0 || id >= static_cast<int32_t>(count)) {
+                return false;
+            }
+        }
+    }
+    return at == end;
+}
+
+// Starts `round` in one step: nobody has moved in it, whatever happened in
+// the rounds skipped on the way
+void startRound(Match& state, uint32_t round) {
+    if (state.getPlayers().getRound() < round) {
+        state.resetPlayersMovedFlag();
+        state.getPlayers().setRound(round);
+    }
+}
+
+} // namespace
+
+bool ReplayWriter::open(const string& path) {
+    out.open(path, ios::binary | ios::trunc);
+    return out.is_open();
+}
+
+void ReplayWriter::writeBytes(const string& bytes) {
+    out.write(bytes.data(), bytes.size());
+    bytesWritten += bytes.size();
+}
+
+void ReplayWriter::writeHeader(const Match& state) {
+    if (!out.is_open()) {
+        return;
+    }
+    const Rules& rules = state.getRules();
+    const PlayerTable& players = state.getPlayers();
+    string bytes(MAGIC, sizeof(MAGIC));
+    putBytes(bytes, REPLAY_VERSION, 2);
+    putBytes(bytes, 0, 2);
+    putBytes(bytes, state.getSeed(), 8);
+    for (double value : {rules.fastExpertBelow, rules.slowExpertBelow, rules.fastNoviceBelow,
+                         rules.expert.head, rules.expert.torso, rules.expert.extremity,
+                         rules.novice.head, rules.novice.torso, rules.novice.extremity}) {
+        putDouble(bytes, value);
+    }
+    putBytes(bytes, static_cast<uint32_t>(state.getRows()), 4);
+    putBytes(bytes, static_cast<uint32_t>(state.getCols()), 4);
+    putBytes(bytes, static_cast<uint32_t>(state.getPlayersPerTeam()), 4);
+    // Small boards can hold fewer players than requested
+    putBytes(bytes, static_cast<uint32_t>(players.size()), 4);
+    for (int id = 0; id < players.size(); ++id) {
+        bytes.push_back(players.getTeam(id));
+        bytes.push_back(static_cast<char>(players.getArchetype(id)));
+        pair<int, int> start = players.getStartPosition(id);
+        putBytes(bytes, static_cast<uint32_t>(start.first), 4);
+        putBytes(bytes, static_cast<uint32_t>(start.second), 4);
+    }
+    writeBytes(bytes);
+}
+
+void ReplayWriter::write(const ReplayRecord& record, const Match& state) {
+    if (!out.is_open()) {
+        return; // Not recording
+    }
+    unsigned char bytes[REPLAY_RECORD_SIZE];
+    encodeRecord(record, bytes);
+    out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    bytesWritten += sizeof(bytes);
+    if (++actions % keyframeInterval == 0) {
+        writeKeyframe(state);
+    }
+}
+
+void ReplayWriter::writeKeyframe(const Match& state) {
+    state.saveSnapshot(snapshot);
+    string payload;
+    putBytes(payload, state.getHash(), 8);
+    for (size_t id = 0; id < snapshot.xs.size(); ++id) {
+        putBytes(payload, static_cast<uint32_t>(snapshot.xs[id]), 4);
+        putBytes(payload, static_cast<uint32_t>(snapshot.ys[id]), 4);
+        payload.push_back(static_cast<char>(snapshot.slots[id]));
+        payload.push_back(static_cast<char>(snapshot.extremityHits[id]));
+        payload.push_back(static_cast<char>(snapshot.eliminationReasons[id]));
+        putBytes(payload, snapshot.movedRounds[id], 4);
+    }
+    for (const vector<int32_t>& eliminated : snapshot.eliminated) {
+        putBytes(payload, eliminated.size(), 4);
+        for (int32_t id : eliminated) {
+            putBytes(payload, static_cast<uint32_t>(id), 4);
+        }
+    }
+
+    index.push_back({bytesWritten, actions, snapshot.round});
+    unsigned char bytes[REPLAY_RECORD_SIZE];
+    encodeRecord({snapshot.round, static_cast<int32_t>(payload.size()), REPLAY_KEYFRAME, 0, 0, 0}, bytes);
+    out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    bytesWritten += sizeof(bytes);
+    writeBytes(payload);
+}
+
+void ReplayWriter::recordMove(const Match& state, int direction, int squares, const MoveResult& result) {
+    write({state.getPlayers().getRound(), result.player, ACTION_MOVE, static_cast<uint8_t>(direction),
+           static_cast<int8_t>(squares), static_cast<uint8_t>(result.status)}, state);
+}
+
+void ReplayWriter::recordAttack(const Match& state, int direction, int squares, const AttackResult& result) {
+    write({state.getPlayers().getRound(), result.shooter, ACTION_ATTACK, static_cast<uint8_t>(direction),
+           static_cast<int8_t>(squares), attackOutcome(result)}, state);
+}
+
+void ReplayWriter::close() {
+    if (!out.is_open()) {
+        return;
+    }
+    uint64_t indexOffset = bytesWritten;
+    string bytes;
+    for (const KeyframeEntry& entry : index) {
+        putBytes(bytes, entry.offset, 8);
+        putBytes(bytes, entry.actions, 8);
+        putBytes(bytes, entry.round, 4);
+    }
+    putBytes(bytes, indexOffset, 8);
+    putBytes(bytes, index.size(), 4);
+    bytes.append(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    writeBytes(bytes);
+    out.close();
+}
+
+bool setupFromReplay(Match& state, const ReplayHeader& header, string& error) {
+    state = Match(header.seed, header.rules);
+    state.setup(header.rows, header.cols, header.playersPerTeam);
+    const PlayerTable& players = state.getPlayers();
+    if (players.size() != static_cast<int>(header.roster.size())) {
+        error = "roster size differs from the recording";
+        return false;
+    }
+    for (int id = 0; id < players.size(); ++id) {
+        const RosterEntry& entry = header.roster[id];
+        if (players.getTeam(id) != entry.team || players.getArchetype(id) != entry.archetype
+            || players.getStartPosition(id) != make_pair(static_cast<int>(entry.x), static_cast<int>(entry.y))) {
+            error = "player " + to_string(id) + " differs from the recording";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ReplayReader::open(const string& path, string& error) {
+    in.open(path, ios::binary);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    char magic[sizeof(MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = path + " is not a replay";
+        return false;
+    }
+
+    Decoder decoder(in);
+    uint64_t version = decoder.read(2);
+    decoder.read(2);
+    if (decoder.ok() && version != REPLAY_VERSION) {
+        error = "unsupported replay version " + to_string(version);
+        return false;
+    }
+    header.seed = decoder.read(8);
+    Rules& rules = header.rules;
+    for (double* value : {&rules.fastExpertBelow, &rules.slowExpertBelow, &rules.fastNoviceBelow,
+                          &rules.expert.head, &rules.expert.torso, &rules.expert.extremity,
+                          &rules.novice.head, &rules.novice.torso, &rules.novice.extremity}) {
+        *value = decoder.readDouble();
+    }
+    header.rows = decoder.readInt();
+    header.cols = decoder.readInt();
+    header.playersPerTeam = decoder.readInt();
+    int32_t rosterSize = decoder.readInt();
+    if (!decoder.ok() || !isValidSetup(header.rows, header.cols, header.playersPerTeam) || rosterSize < 0 || rosterSize > 2 * static_cast<int64_t>(header.playersPerTeam)) {
+        error = "corrupt replay header";
+        return false;
+    }
+    header.roster.clear();
+    for (int id = 0; id < rosterSize && decoder.ok(); ++id) {
+        RosterEntry entry;
+        entry.team = static_cast<char>(decoder.read(1));
+        entry.archetype = static_cast<uint8_t>(decoder.read(1));
+        entry.x = decoder.readInt();
+        entry.y = decoder.readInt();
+        header.roster.push_back(entry);
+    }
+    if (!decoder.ok()) {
+        error = "truncated replay roster";
+        return false;
+    }
+
+    recordsBegin = static_cast<uint64_t>(in.tellg());
+    in.seekg(0, ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    if (!readIndex(fileSize)) {
+        index.clear();
+        recordsEnd = fileSize;
+    }
+    in.clear();
+    in.seekg(recordsBegin);
+    position = recordsBegin;
+    actionIndex = 0;
+    return true;
+}
+
+bool ReplayReader::readIndex(uint64_t fileSize) {
+    if (fileSize < recordsBegin + FOOTER_SIZE) {
+        return false;
+    }
+    unsigned char footer[FOOTER_SIZE];
+    in.seekg(fileSize - FOOTER_SIZE);
+    if (!in.read(reinterpret_cast<char*>(footer), sizeof(footer))
+        || memcmp(footer + 12, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        return false;
+    }
+    uint64_t indexOffset = getBytes(footer, 8);
+    uint64_t count = getBytes(footer + 8, 4);
+    if (indexOffset < recordsBegin || indexOffset + count * INDEX_ENTRY_SIZE + FOOTER_SIZE != fileSize) {
+        return false;
+    }
+
+    vector<unsigned char> bytes(count * INDEX_ENTRY_SIZE);
+    in.seekg(indexOffset);
+    if (!in.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) {
+        return false;
+    }
+    index.resize(count);
+    for (uint64_t i = 0; i < count; ++i) {
+        const unsigned char* at = &bytes[i * INDEX_ENTRY_SIZE];
+        index[i] = {getBytes(at, 8), getBytes(at + 8, 8), static_cast<uint32_t>(getBytes(at + 16, 4))};
+        if (index[i].offset < recordsBegin || index[i].offset >= indexOffset) {
+            return false;
+        }
+    }
+    recordsEnd = indexOffset;
+    return true;
+}
+
+bool ReplayReader::next(ReplayRecord& record) {
+    unsigned char bytes[REPLAY_RECORD_SIZE];
+    while (position + REPLAY_RECORD_SIZE <= recordsEnd) {
+        if (!in.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+            return false;
+        }
+        position += sizeof(bytes);
+        decodeRecord(bytes, record);
+        if (record.kind != REPLAY_KEYFRAME) {
+            actionIndex++;
+            return true;
+        }
+        // Playing on from the previous action leads to the same state
+        position += static_cast<uint32_t>(record.player);
+        in.seekg(position);
+    }
+    return false; // A partial trailing record is dropped
+}
+
+bool ReplayReader::loadKeyframe(const KeyframeEntry& entry, Match& state, string& error) {
+    unsigned char bytes[REPLAY_RECORD_SIZE];
+    ReplayRecord record;
+    in.clear();
+    in.seekg(entry.offset);
+    if (!in.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+        error = "truncated keyframe";
+        return false;
+    }
+    decodeRecord(bytes, record);
+    uint64_t payloadEnd = entry.offset + REPLAY_RECORD_SIZE + static_cast<uint32_t>(record.player);
+    if (record.kind != REPLAY_KEYFRAME || payloadEnd > recordsEnd) {
+        error = "index does not point at a keyframe";
+        return false;
+    }
+    payload.resize(static_cast<uint32_t>(record.player));
+    uint64_t hash;
+    snapshot.round = record.round;
+    if (!in.read(reinterpret_cast<char*>(payload.data()), payload.size())
+        || !decodeKeyframe(payload.data(), payload.size(), header, snapshot, hash)) {
+        error = "corrupt keyframe";
+        return false;
+    }
+
+    if (!setupFromReplay(state, header, error)) {
+        return false;
+    }
+    state.restoreSnapshot(snapshot);
+    if (state.getHash() != hash) {
+        error = "keyframe does not match its hash";
+        return false;
+    }
+    position = payloadEnd;
+    actionIndex = entry.actions;
+    return true;
+}
+
+bool ReplayReader::seekToRound(Match& state, uint32_t round, string& error) {
+    // The latest keyframe taken before `round` started
+    auto after = partition_point(index.begin(), index.end(),
+                                 [round](const KeyframeEntry& entry) { return entry.round < round; });
+    if (after != index.begin()) {
+        if (!loadKeyframe(*(after - 1), state, error)) {
+            return false;
+        }
+    } else {
+        if (!setupFromReplay(state, header, error)) {
+            return false;
+        }
+        in.clear();
+        in.seekg(recordsBegin);
+        position = recordsBegin;
+        actionIndex = 0;
+    }
+
+    // Then only the actions between it and the round
+    ReplayRecord record;
+    ReplayStep step;
+    while (true) {
+        uint64_t before = position;
+        uint64_t actionsBefore = actionIndex;
+        if (!next(record)) {
+            break;
+        }
+        if (record.round >= round) {
+            in.clear();
+            in.seekg(before);
+            position = before;
+            actionIndex = actionsBefore;
+            break;
+        }
+        if (!applyReplayRecord(state, record, step, error)) {
+            error = "action " + to_string(actionsBefore) + ": " + error;
+            return false;
+        }
+    }
+    startRound(state, round);
+    return true;
+}
+
+bool applyReplayRecord(Match& state, const ReplayRecord& record, ReplayStep& step, string& error) {
+    const PlayerTable& players = state.getPlayers();
+    if (record.kind != ACTION_MOVE && record.kind != ACTION_ATTACK) {
+        error = "unknown record kind " + to_string(record.kind);
+        return false;
+    }
+    if (record.player < 0 || record.player >= players.size()) {
+        error = "player " + to_string(record.player) + " out of range";
+        return false;
+    }
+    if (record.direction < UP || record.direction > RIGHT) {
+        error = "direction " + to_string(record.direction) + " out of range";
+        return false;
+    }
+    if (record.squares != -1 && record.squares != 1 && record.squares != 2) {
+        error = "distance " + to_string(record.squares) + " out of range";
+        return false;
+    }
+    if (record.round < players.getRound() || record.round > MAX_REPLAY_ROUND) {
+        error = "round " + to_string(record.round) + " out of range";
+        return false;
+    }
+    startRound(state, record.round);
+
+    step.kind = static_cast<ActionKind>(record.kind);
+    if (record.kind == ACTION_MOVE) {
+        step.move = state.move(record.player, record.direction, record.squares);
+        if (step.move.status == record.outcome) {
+            return true;
+        }
+    } else {
+        step.attack = state.attack(record.player, record.direction, record.squares);
+        if (attackOutcome(step.attack) == record.outcome) {
+            return true;
+        }
+    }
+    error = "replay diverges";
+    return false;
+}
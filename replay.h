@@ -0,0 +1,143 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "engine.h"
+
+// Binary match recordings. Setup is a pure function of the seed, the rules
+// and the board size, and every later draw is keyed by (round, player), so a
+// replay only needs those plus one fixed-size record per attempted action.
+// The roster is stored too, to catch recordings made by a different engine.
+//
+// Every `keyframeInterval` actions a keyframe with the full MatchSnapshot
+// follows, and a trailing index lists them all, so a viewer can jump to any
+// round by restoring the nearest keyframe and replaying only what follows.
+//
+// Layout, all integers little-endian:
+//   header    "PBRP", u16 version, u16 reserved, u64 seed, 9 x f64 rules,
+//             i32 rows, i32 cols, i32 players per team, i32 roster size,
+//             per player: u8 team, u8 archetype, i32 x, i32 y
+//   records   REPLAY_RECORD_SIZE bytes each. A keyframe is a record of kind
+//             REPLAY_KEYFRAME whose `player` field is the payload size:
+//             u64 hash, per player: i32 x, i32 y, u8 slot, u8 extremity
+//             hits, u8 elimination reason, u32 moved round; then per team
+//             i32 count and the eliminated IDs in order
+//   index     per keyframe: u64 file offset, u64 actions before it, u32 round
+//   footer    u64 index offset, u32 keyframe count, "PBRX"
+// A file without the footer (the game did not exit cleanly) still plays
+// from the start; it just cannot seek.
+
+const uint16_t REPLAY_VERSION = 2;
+const int REPLAY_RECORD_SIZE = 12;
+const uint8_t REPLAY_KEYFRAME = 2; // Record kind next to the ActionKind values
+const int DEFAULT_KEYFRAME_INTERVAL = 1024;
+// Rounds past this are taken as corruption: at a round per millisecond a
+// match would need twelve days to get there
+const uint32_t MAX_REPLAY_ROUND = 1u << 30;
+
+struct KeyframeEntry {
+    uint64_t offset; // Of the keyframe record
+    uint64_t actions; // Recorded before the keyframe
+    uint32_t round;
+};
+
+struct RosterEntry {
+    char team;
+    uint8_t archetype; // ArchetypeFlags
+    int32_t x, y; // Start position
+};
+
+struct ReplayHeader {
+    uint64_t seed;
+    Rules rules;
+    int32_t rows;
+    int32_t cols;
+    int32_t playersPerTeam;
+    std::vector<RosterEntry> roster; // By player ID
+};
+
+// One move or attack as it was requested, including rejected ones: they
+// still use up the player's turn. `outcome` lets playback detect a desync.
+struct ReplayRecord {
+    uint32_t round; // PlayerTable round the action was taken in
+    int32_t player;
+    uint8_t kind; // ActionKind
+    uint8_t direction;
+    int8_t squares; // As requested; -1 lets the match draw it
+    uint8_t outcome; // MoveStatus, or AttackStatus | HitLocation << 4
+};
+
+class ReplayWriter {
+private:
+    std::ofstream out;
+    int keyframeInterval;
+    uint64_t bytesWritten;
+    uint64_t actions;
+    std::vector<KeyframeEntry> index;
+    MatchSnapshot snapshot; // Scratch for keyframes
+    void writeBytes(const std::string& bytes);
+    void write(const ReplayRecord& record, const Match& state);
+    void writeKeyframe(const Match& state);
+public:
+    explicit ReplayWriter(int keyframeInterval = DEFAULT_KEYFRAME_INTERVAL)
+        : keyframeInterval(keyframeInterval), bytesWritten(0), actions(0) {}
+    ~ReplayWriter() { close(); }
+    bool open(const std::string& path);
+    bool isOpen() const { return out.is_open(); }
+    // Once, right after Match::setup(). Like the record calls, a no-op
+    // unless open() succeeded.
+    void writeHeader(const Match& state);
+    // After every Match::move() / Match::attack(), with the arguments it got
+    void recordMove(const Match& state, int direction, int squares, const MoveResult& result);
+    void recordAttack(const Match& state, int direction, int squares, const AttackResult& result);
+    // Appends the index; called by the destructor too
+    void close();
+};
+
+// Rebuilds the recorded starting position. Fails if this engine does not
+// deal the same roster from the recorded seed.
+bool setupFromReplay(Match& state, const ReplayHeader& header, std::string& error);
+
+class ReplayReader {
+private:
+    std::ifstream in;
+    ReplayHeader header;
+    uint64_t recordsBegin;
+    uint64_t recordsEnd; // The index, or the end of a file without one
+    uint64_t position;
+    uint64_t actionIndex; // Actions read so far
+    std::vector<KeyframeEntry> index;
+    std::vector<unsigned char> payload; // Scratch for keyframes
+    MatchSnapshot snapshot;
+    bool readIndex(uint64_t fileSize);
+    bool loadKeyframe(const KeyframeEntry& entry, Match& state, std::string& error);
+public:
+    ReplayReader() : recordsBegin(0), recordsEnd(0), position(0), actionIndex(0) {}
+    // On failure `error` says why
+    bool open(const std::string& path, std::string& error);
+    const ReplayHeader& getHeader() const { return header; }
+    const std::vector<KeyframeEntry>& getIndex() const { return index; }
+    uint64_t getActionIndex() const { return actionIndex; }
+    bool next(ReplayRecord& record); // Skips keyframes; false at the end
+    // Leaves `state` at the start of `round`, before any of its actions, and
+    // the reader at the first action of that round
+    bool seekToRound(Match& state, uint32_t round, std::string& error);
+};
+
+// What one replayed record did (only the member matching `kind` is set)
+struct ReplayStep {
+    ActionKind kind;
+    MoveResult move;
+    AttackResult attack;
+};
+
+// Starts the recorded round if needed and plays the record through the
+// engine. Returns false, with `error` saying why, if a field is out of range
+// or it does not end as recorded.
+bool applyReplayRecord(Match& state, const ReplayRecord& record, ReplayStep& step, std::string& error);
+
+#endif
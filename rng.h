@@ -0,0 +1,49 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+// Counter-based random numbers. A draw is a pure function of a key and a
+// counter, so there is no generator state to carry around or share: the same
+// (seed, round, player, stream) always gives the same number, whatever else
+// ran before it or on other threads.
+
+// SplitMix64 finalizer: a bijective mix with full avalanche
+inline uint64_t splitMix64(uint64_t z) {
+    z += 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// What a draw is used for, so draws of one player in one round never collide
+enum RandomStream : uint32_t {
+    RNG_FLAG_SIDE = 1,
+    RNG_ARCHETYPE,
+    RNG_MOVE_DISTANCE,
+    RNG_ATTACK_RANGE,
+    RNG_HIT,
+    RNG_USER_TEAM,
+    RNG_START_TEAM
+};
+
+class CounterRng {
+private:
+    uint64_t key;
+public:
+    explicit CounterRng(uint64_t seed = 0) : key(splitMix64(seed)) {}
+    // `player` is -1 for draws that belong to the whole match
+    uint64_t draw(uint64_t round, int32_t player, RandomStream stream) const {
+        uint64_t counter = (round << 32) ^ (static_cast<uint64_t>(static_cast<uint32_t>(player)) << 4) ^ stream;
+        return splitMix64(key ^ splitMix64(counter));
+    }
+    // Uniform in [0, 1) with 53 random bits
+    double uniform(uint64_t round, int32_t player, RandomStream stream) const {
+        return (draw(round, player, stream) >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+// A seed that differs between runs, even several started in the same second
+uint64_t freshSeed();
+
+#endif
@@ -0,0 +1,176 @@
+#include "sdl_audio.h"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+#include <SDL.h>
+
+using namespace std;
+
+namespace {
+
+const char* const EFFECT_FILES[SOUND_COUNT] = {"music/jump.mp3", "music/gameover.mp3"};
+const char* const EFFECT_NAMES[SOUND_COUNT] = {"jump", "game over"};
+
+} // namespace
+
+SdlAudio::SdlAudio()
+    : music(nullptr), requested(0), loaded(false), stopping(false), open(false), loadMs(-1), coalesced(0) {
+    for (Mix_Chunk*& chunk : effects) {
+        chunk = nullptr;
+    }
+    worker = thread(&SdlAudio::run, this);
+}
+
+SdlAudio::~SdlAudio() {
+    {
+        lock_guard<mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+    if (!open) {
+        return;
+    }
+
+    // Stop the music
+    Mix_HaltMusic();
+
+    // Free the music and sound effects
+    if (music) {
+        Mix_FreeMusic(music);
+        music = nullptr;
+    }
+    for (Mix_Chunk*& chunk : effects) {
+        if (chunk) {
+            Mix_FreeChunk(chunk);
+            chunk = nullptr;
+        }
+    }
+
+    // Close the audio device
+    Mix_CloseAudio();
+
+    // Quit SDL subsystems
+    SDL_Quit();
+}
+
+// Runs on the worker, before anything else uses SDL
+void SdlAudio::load() {
+    auto start = chrono::steady_clock::now();
+    ostringstream errors;
+
+    // Initialize SDL2
+    if (SDL_Init(SDL_INIT_AUDIO) < 0) {
+        errors << "SDL could not initialize! SDL_Error: " << SDL_GetError() << "\n";
+        loadErrors = errors.str();
+        return;
+    }
+
+    // Initialize SDL_mixer
+    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+        errors << "SDL_mixer could not initialize! SDL_mixer Error: " << Mix_GetError() << "\n";
+        loadErrors = errors.str();
+        SDL_Quit();
+        return;
+    }
+    open = true;
+
+    // Load background music; it is streamed, so this only reads the header
+    music = Mix_LoadMUS("music/juego.mp3");
+    if (!music) {
+        errors << "Failed to load background music! SDL_mixer Error: " << Mix_GetError() << "\n";
+    }
+
+    // Effects are decoded whole into PCM chunks in the device's format
+    for (int e = 0; e < SOUND_COUNT; ++e) {
+        effects[e] = Mix_LoadWAV(EFFECT_FILES[e]);
+        if (!effects[e]) {
+            errors << "Failed to load " << EFFECT_NAMES[e] << " sound effect! SDL_mixer Error: " << Mix_GetError()
+                   << "\n";
+        }
+    }
+    loadErrors = errors.str();
+    loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void SdlAudio::run() {
+    load();
+    {
+        lock_guard<mutex> lock(stateMutex);
+        loaded = true;
+    }
+    wake.notify_all();
+
+    chrono::steady_clock::time_point lastStart[SOUND_COUNT];
+    bool everStarted[SOUND_COUNT] = {};
+    const chrono::milliseconds window(EFFECT_WINDOW_MS);
+    while (true) {
+        unsigned effectsToStart;
+        {
+            unique_lock<mutex> lock(stateMutex);
+            wake.wait(lock, [this] { return stopping || requested != 0; });
+            if (stopping) {
+                return;
+            }
+            effectsToStart = requested;
+            requested = 0;
+        }
+
+        auto now = chrono::steady_clock::now();
+        for (int e = 0; e < SOUND_COUNT; ++e) {
+            if (!(effectsToStart & (1u << e)) || !effects[e]) {
+                continue;
+            }
+            if (everStarted[e] && now - lastStart[e] < window) {
+                coalesced++;
+                continue;
+            }
+            Mix_PlayChannel(-1, effects[e], 0);
+            lastStart[e] = now;
+            everStarted[e] = true;
+        }
+    }
+}
+
+bool SdlAudio::waitUntilReady(string& errors) {
+    unique_lock<mutex> lock(stateMutex);
+    wake.wait(lock, [this] { return loaded; });
+    errors = loadErrors;
+    return loadErrors.empty();
+}
+
+// Music starts once per match, so it does not go through the worker
+void SdlAudio::playMusic() {
+    string errors;
+    waitUntilReady(errors);
+    if (!open || !music) {
+        return;
+    }
+
+    // Play music
+    if (Mix_PlayMusic(music, -1) == -1) { // -1 to loop indefinitely
+        cerr << "Mix_PlayMusic failed: " << Mix_GetError() << endl;
+    }
+}
+
+void SdlAudio::stopMusic() {
+    string errors;
+    waitUntilReady(errors);
+    if (open) {
+        Mix_HaltMusic();
+    }
+}
+
+void SdlAudio::playEffect(SoundEffect effect) {
+    {
+        lock_guard<mutex> lock(stateMutex);
+        if (requested & (1u << effect)) {
+            coalesced++; // Still waiting for the worker
+            return;
+        }
+        requested |= 1u << effect;
+    }
+    wake.notify_one();
+}
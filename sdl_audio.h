@@ -0,0 +1,48 @@
+#ifndef SDL_AUDIO_H
+#define SDL_AUDIO_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <SDL_mixer.h>
+
+#include "audio.h"
+
+// SDL_mixer behind AudioBackend. One thread opens the device and decodes the
+// music and every effect to PCM once, as soon as the object is created, and
+// then stays to start the effects the game asks for, so the game thread only
+// ever sets a flag. Requests for an effect that started less than
+// EFFECT_WINDOW_MS ago are dropped: a burst of program actions sounds as one
+// jump instead of piling up overlapping channels.
+class SdlAudio : public AudioBackend {
+public:
+    static const int EFFECT_WINDOW_MS = 120;
+private:
+    Mix_Music* music;
+    Mix_Chunk* effects[SOUND_COUNT];
+    std::thread worker;
+    std::mutex stateMutex; // Guards the three fields below; never held while mixing
+    std::condition_variable wake;
+    unsigned requested; // Bit per SoundEffect, not started yet
+    bool loaded;
+    bool stopping;
+    bool open; // The device opened; set before `loaded`
+    std::string loadErrors;
+    double loadMs;
+    std::atomic<long long> coalesced;
+    void run();
+    void load();
+public:
+    SdlAudio();
+    ~SdlAudio();
+    bool waitUntilReady(std::string& errors) override;
+    double getLoadMs() const override { return loadMs; }
+    void playMusic() override;
+    void stopMusic() override;
+    void playEffect(SoundEffect effect) override;
+    long long getCoalescedEffects() const override { return coalesced.load(); }
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "sweep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "greedy.h"
+
+using namespace std;
+
+namespace {
+
+// Matches a worker claims from its own range at a time
+const uint32_t CHUNK = 16;
+
+// Half-open range of match indices owned by one worker, packed as
+// begin << 32 | end so that the owner and thieves both update it with one CAS
+struct alignas(64) WorkRange {
+    atomic<uint64_t> bounds;
+};
+
+uint64_t packRange(uint32_t begin, uint32_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | end;
+}
+
+// Owner side: take up to CHUNK indices from the front
+bool claim(WorkRange& range, uint32_t& begin, uint32_t& end) {
+    uint64_t current = range.bounds.load(memory_order_acquire);
+    while (true) {
+        uint32_t first = static_cast<uint32_t>(current >> 32);
+        uint32_t last = static_cast<uint32_t>(current);
+        if (first >= last) {
+            return false;
+        }
+        uint32_t taken = min(last - first, CHUNK);
+        if (range.bounds.compare_exchange_weak(current, packRange(first + taken, last), memory_order_acq_rel)) {
+            begin = first;
+            end = first + taken;
+            return true;
+        }
+    }
+}
+
+// Thief side: take the back half of what a victim has left
+bool steal(WorkRange& victim, uint32_t& begin, uint32_t& end) {
+    uint64_t current = victim.bounds.load(memory_order_acquire);
+    while (true) {
+        uint32_t first = static_cast<uint32_t>(current >> 32);
+        uint32_t last = static_cast<uint32_t>(current);
+        if (first >= last) {
+            return false;
+        }
+        uint32_t middle = first + (last - first) / 2;
+        if (victim.bounds.compare_exchange_weak(current, packRange(first, middle), memory_order_acq_rel)) {
+            begin = middle;
+            end = last;
+            return true;
+        }
+    }
+}
+
+// Running totals of one grid point, owned by a single worker
+struct PointTotals {
+    long long matches = 0;
+    long long redWins = 0;
+    long long blueWins = 0;
+    long long draws = 0;
+    long long totalTurns = 0;
+};
+
+void runWorker(size_t self, vector<WorkRange>& ranges, const vector<SweepPoint>& points,
+               const SweepConfig& config, vector<PointTotals>& totals) {
+    GreedyPolicy policy;
+    uint32_t begin, end;
+    while (true) {
+        if (!claim(ranges[self], begin, end)) {
+            bool stolen = false;
+            for (size_t k = 1; k < ranges.size() && !stolen; ++k) {
+                stolen = steal(ranges[(self + k) % ranges.size()], begin, end);
+            }
+            if (!stolen) {
+                return; // Nothing left anywhere: ranges only ever shrink
+            }
+            // Our range is empty, so nobody else writes it until this store
+            ranges[self].bounds.store(packRange(begin, end), memory_order_release);
+            continue;
+        }
+
+        for (uint32_t index = begin; index < end; ++index) {
+            const SweepPoint& point = points[index / config.matchesPerPoint];
+            Match match(splitMix64(config.seed ^ splitMix64(index)), point.rules);
+            match.setup(point.board.rows, point.board.cols, point.board.playersPerTeam);
+            MatchSummary summary = playGreedyMatch(match, policy, config.maxTurns);
+
+            PointTotals& total = totals[index / config.matchesPerPoint];
+            total.matches++;
+            total.totalTurns += summary.turns;
+            if (summary.outcome.reason == NOT_ENDED) {
+                total.draws++;
+            } else if (summary.outcome.winner == 'R') {
+                total.redWins++;
+            } else {
+                total.blueWins++;
+            }
+        }
+    }
+}
+
+} // namespace
+
+vector<SweepPoint> runSweep(const SweepConfig& config) {
+    vector<SweepPoint> points;
+    for (const BoardSize& board : config.boards) {
+        for (const ArchetypeMix& mix : config.mixes) {
+            for (const HitChances& expert : config.expertChances) {
+                for (const HitChances& novice : config.noviceChances) {
+                    Rules rules;
+                    rules.fastExpertBelow = mix.fastExpertBelow;
+                    rules.slowExpertBelow = mix.slowExpertBelow;
+                    rules.fastNoviceBelow = mix.fastNoviceBelow;
+                    rules.expert = expert;
+                    rules.novice = novice;
+                    points.push_back({board, rules, 0, 0, 0, 0, 0});
+                }
+            }
+        }
+    }
+    long long totalMatches = static_cast<long long>(points.size()) * config.matchesPerPoint;
+    if (totalMatches <= 0 || totalMatches > MAX_SWEEP_MATCHES) {
+        return points;
+    }
+
+    int threadCount = config.threads > 0 ? config.threads : static_cast<int>(thread::hardware_concurrency());
+    threadCount = max(1, threadCount);
+
+    // Every worker starts with an equal slice and steals once it runs dry
+    vector<WorkRange> ranges(threadCount);
+    for (int t = 0; t < threadCount; ++t) {
+        uint32_t begin = static_cast<uint32_t>(totalMatches * t / threadCount);
+        uint32_t end = static_cast<uint32_t>(totalMatches * (t + 1) / threadCount);
+        ranges[t].bounds.store(packRange(begin, end), memory_order_relaxed);
+    }
+
+    vector<vector<PointTotals>> totals(threadCount, vector<PointTotals>(points.size()));
+    vector<thread> workers;
+    for (int t = 1; t < threadCount; ++t) {
+        workers.emplace_back(runWorker, t, ref(ranges), cref(points), cref(config), ref(totals[t]));
+    }
+    runWorker(0, ranges, points, config, totals[0]);
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    for (const vector<PointTotals>& threadTotals : totals) {
+        for (size_t i = 0; i < points.size(); ++i) {
+            points[i].matches += threadTotals[i].matches;
+            points[i].redWins += threadTotals[i].redWins;
+            points[i].blueWins += threadTotals[i].blueWins;
+            points[i].draws += threadTotals[i].draws;
+            points[i].totalTurns += threadTotals[i].totalTurns;
+        }
+    }
+    return points;
+}
+
+void writeSweepCsv(ostream& out, const vector<SweepPoint>& points) {
+    out << "rows,cols,players_per_team,fast_expert_below,slow_expert_below,fast_novice_below,"
+        << "expert_head,expert_torso,expert_extremity,novice_head,novice_torso,novice_extremity,"
+        << "matches,red_wins,blue_wins,draws,red_win_rate,blue_win_rate,draw_rate,mean_turns\n";
+    for (const SweepPoint& point : points) {
+        const Rules& rules = point.rules;
+        double matches = point.matches > 0 ? static_cast<double>(point.matches) : 1.0;
+        out << point.board.rows << ',' << point.board.cols << ',' << point.board.playersPerTeam << ','
+            << rules.fastExpertBelow << ',' << rules.slowExpertBelow << ',' << rules.fastNoviceBelow << ','
+            << rules.expert.head << ',' << rules.expert.torso << ',' << rules.expert.extremity << ','
+            << rules.novice.head << ',' << rules.novice.torso << ',' << rules.novice.extremity << ','
+            << point.matches << ',' << point.redWins << ',' << point.blueWins << ',' << point.draws << ','
+            << point.redWins / matches << ',' << point.blueWins / matches << ',' << point.draws / matches << ','
+            << point.totalTurns / matches << '\n';
+    }
+}
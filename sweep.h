@@ -0,0 +1,59 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "engine.h"
+
+// Balance studies: greedy-vs-greedy matches for every combination of board
+// size, archetype mix and hit chances. Matches are spread over a
+// work-stealing thread pool, and every match is seeded from its own index, so
+// the results do not depend on the number of threads.
+
+struct BoardSize {
+    int rows;
+    int cols;
+    int playersPerTeam;
+};
+
+// Archetype draw thresholds, in Rules order
+struct ArchetypeMix {
+    double fastExpertBelow;
+    double slowExpertBelow;
+    double fastNoviceBelow;
+};
+
+struct SweepConfig {
+    std::vector<BoardSize> boards;
+    std::vector<ArchetypeMix> mixes;
+    std::vector<HitChances> expertChances;
+    std::vector<HitChances> noviceChances;
+    long long matchesPerPoint = 1000;
+    int maxTurns = 10000; // Longer matches count as draws
+    int threads = 0; // 0 = one per hardware thread
+    uint64_t seed = 1;
+};
+
+// Aggregated results of one grid point
+struct SweepPoint {
+    BoardSize board;
+    Rules rules;
+    long long matches;
+    long long redWins;
+    long long blueWins;
+    long long draws;
+    long long totalTurns;
+};
+
+// Largest number of matches (points x matches per point) a sweep can run
+const long long MAX_SWEEP_MATCHES = 0xFFFFFFFFll;
+
+// Plays the whole grid. The number of points is the product of the list sizes.
+std::vector<SweepPoint> runSweep(const SweepConfig& config);
+
+// One CSV row per point, with a header line
+void writeSweepCsv(std::ostream& out, const std::vector<SweepPoint>& points);
+
+#endif
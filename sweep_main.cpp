@@ -0,0 +1,140 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sweep.h"
+
+using namespace std;
+
+void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [--boards RxCxP,...] [--mixes FE/SE/FN,...]\n"
+         << "       [--expert HEAD/TORSO/EXTREMITY,...] [--novice HEAD/TORSO/EXTREMITY,...]\n"
+         << "       [--matches N] [--max-turns T] [--threads N] [--seed N] [--out FILE]\n"
+         << "Every list defaults to the standard game; the grid is their product.\n";
+}
+
+// Splits "a,b,c" and parses every item as `separator`-joined numbers
+bool parseList(const string& text, char separator, size_t fields, vector<vector<double>>& out) {
+    out.clear();
+    stringstream items(text);
+    string item;
+    while (getline(items, item, ',')) {
+        vector<double> values;
+        stringstream parts(item);
+        string part;
+        while (getline(parts, part, separator)) {
+            try {
+                values.push_back(stod(part));
+            } catch (const exception& e) {
+                return false;
+            }
+        }
+        if (values.size() != fields) {
+            return false;
+        }
+        out.push_back(values);
+    }
+    return !out.empty();
+}
+
+int main(int argc, char* argv[]) {
+    Rules standard;
+    SweepConfig config;
+    config.boards = {{8, 8, 4}};
+    config.mixes = {{standard.fastExpertBelow, standard.slowExpertBelow, standard.fastNoviceBelow}};
+    config.expertChances = {standard.expert};
+    config.noviceChances = {standard.novice};
+    string outPath;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        vector<vector<double>> items;
+        bool valid = true;
+        try {
+            if (arg == "--boards") {
+                valid = parseList(value, 'x', 3, items);
+                config.boards.clear();
+                for (const vector<double>& item : items) {
+                    // Range first: out-of-range doubles do not convert to int
+                    valid = valid && item[0] >= 1 && item[0] <= MAX_BOARD_SIDE && item[1] >= 1
+                        && item[1] <= MAX_BOARD_SIDE && item[2] >= 1 && item[2] <= MAX_PLAYERS_PER_TEAM;
+                    if (valid) {
+                        config.boards.push_back({static_cast<int>(item[0]), static_cast<int>(item[1]), static_cast<int>(item[2])});
+                    }
+                }
+            } else if (arg == "--mixes") {
+                valid = parseList(value, '/', 3, items);
+                config.mixes.clear();
+                for (const vector<double>& item : items) {
+                    config.mixes.push_back({item[0], item[1], item[2]});
+                    // Cumulative thresholds: within [0, 1] and strictly ascending
+                    valid = valid && item[0] >= 0 && item[0] < item[1] && item[1] < item[2] && item[2] <= 1;
+                }
+            } else if (arg == "--expert" || arg == "--novice") {
+                valid = parseList(value, '/', 3, items);
+                vector<HitChances>& chances = arg == "--expert" ? config.expertChances : config.noviceChances;
+                chances.clear();
+                for (const vector<double>& item : items) {
+                    chances.push_back({item[0], item[1], item[2]});
+                    valid = valid && item[0] >= 0 && item[1] >= 0 && item[2] >= 0;
+                }
+            }
+            else if (arg == "--matches") config.matchesPerPoint = stoll(value);
+            else if (arg == "--max-turns") config.maxTurns = stoi(value);
+            else if (arg == "--threads") config.threads = stoi(value);
+            else if (arg == "--seed") config.seed = stoull(value);
+            else if (arg == "--out") outPath = value;
+            else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } catch (const exception& e) {
+            valid = false;
+        }
+        if (!valid) {
+            cerr << "Invalid value for " << arg << ": " << value << "\n";
+            return 1;
+        }
+    }
+
+    long long points = static_cast<long long>(config.boards.size() * config.mixes.size()
+                                              * config.expertChances.size() * config.noviceChances.size());
+    if (config.matchesPerPoint <= 0 || config.maxTurns <= 0 || config.threads < 0) {
+        cerr << "Matches and turns must be positive and the thread count non-negative.\n";
+        return 1;
+    }
+    // Divided rather than multiplied, so a huge --matches cannot overflow
+    if (config.matchesPerPoint > MAX_SWEEP_MATCHES / points) {
+        cerr << "Too many matches: at most " << MAX_SWEEP_MATCHES << " per sweep.\n";
+        return 1;
+    }
+
+    ofstream file;
+    if (!outPath.empty()) {
+        file.open(outPath);
+        if (!file) {
+            cerr << "Cannot write " << outPath << "\n";
+            return 1;
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<SweepPoint> results = runSweep(config);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    writeSweepCsv(outPath.empty() ? cout : file, results);
+    long long matches = points * config.matchesPerPoint;
+    int threads = config.threads > 0 ? config.threads : max(1u, thread::hardware_concurrency());
+    cerr << matches << " matches in " << seconds << " s (" << static_cast<long long>(matches / seconds)
+         << " matches/s on " << threads << " threads)\n";
+    return 0;
+}